@@ -23,6 +23,8 @@
 #define TAG_CACHE_DATA 'DcaC'
 #define TAG_CACHE_BLOCK 'BcaC'
 
+#define CACHE_HASH_BUCKETS      64      // Must be a power of two
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // This structure describes a cached block element. The disk is divided up into
@@ -35,6 +37,7 @@
 typedef struct
 {
     LIST_ENTRY    ListEntry;                    // Doubly linked list synchronization member
+    LIST_ENTRY    HashEntry;                    // Links the block into its hash bucket
 
     ULONG            BlockNumber;                // Track index for CHS, 64k block index for LBA
     BOOLEAN        LockedInCache;                // Indicates that this block is locked in cache memory
@@ -57,7 +60,8 @@ typedef struct
     ULONG            BytesPerSector;
 
     ULONG            BlockSize;            // Block size (in sectors)
-    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures
+    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures, most recently used first
+    LIST_ENTRY        CacheHashTable[CACHE_HASH_BUCKETS]; // Same blocks, hashed by block number
 
 } CACHE_DRIVE, *PCACHE_DRIVE;
 
@@ -79,7 +83,7 @@ extern    SIZE_T                CacheSizeCurrent;
 //
 ///////////////////////////////////////////////////////////////////////////////////////
 PCACHE_BLOCK    CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                // Returns a pointer to a CACHE_BLOCK structure given a block number
-PCACHE_BLOCK    CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                    // Searches the block list for a particular block
+PCACHE_BLOCK    CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                    // Looks up a particular block in the hash table
 PCACHE_BLOCK    CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                // Adds a block to the cache's block list
 BOOLEAN            CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive);                                    // Removes a block from the cache's block list & frees the memory
 VOID            CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive);                            // Checks the cache size limits to see if we can add a new block, if not calls CacheInternalFreeBlock()
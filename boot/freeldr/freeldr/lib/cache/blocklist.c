@@ -22,6 +22,9 @@
 #include <debug.h>
 DBG_DEFAULT_CHANNEL(CACHE);
 
+#define CacheInternalHashBucket(CacheDrive, BlockNumber) \
+    (&(CacheDrive)->CacheHashTable[(BlockNumber) & (CACHE_HASH_BUCKETS - 1)])
+
 // Returns a pointer to a CACHE_BLOCK structure
 // Adds the block to the cache manager block list
 // in cache memory if it isn't already there
@@ -37,51 +40,46 @@ PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNu
     {
         TRACE("Cache hit! BlockNumber: %d CacheBlock->BlockNumber: %d\n", BlockNumber, CacheBlock->BlockNumber);
 
+        // Increment the blocks access count
+        CacheBlock->AccessCount++;
+
+        // Keep the block list in LRU order
+        CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
+
         return CacheBlock;
     }
 
     TRACE("Cache miss! BlockNumber: %d\n", BlockNumber);
 
+    // The new block is added at the head of the block list
     CacheBlock = CacheInternalAddBlockToCache(CacheDrive, BlockNumber);
 
-    // Optimize the block list so it has a LRU structure
-    CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
-
     return CacheBlock;
 }
 
 PCACHE_BLOCK CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 {
-    PCACHE_BLOCK    CacheBlock = NULL;
+    PLIST_ENTRY     HashBucket;
+    PLIST_ENTRY     Entry;
+    PCACHE_BLOCK    CacheBlock;
 
     TRACE("CacheInternalFindBlock() BlockNumber = %d\n", BlockNumber);
 
     //
-    // Make sure the block list has entries before I start searching it.
+    // Search the hash bucket of this block number
     //
-    if (!IsListEmpty(&CacheDrive->CacheBlockHead))
+    HashBucket = CacheInternalHashBucket(CacheDrive, BlockNumber);
+
+    for (Entry = HashBucket->Flink; Entry != HashBucket; Entry = Entry->Flink)
     {
+        CacheBlock = CONTAINING_RECORD(Entry, CACHE_BLOCK, HashEntry);
+
         //
-        // Search the list and find the BIOS drive number
+        // We found the block, so return it
         //
-        CacheBlock = CONTAINING_RECORD(CacheDrive->CacheBlockHead.Flink, CACHE_BLOCK, ListEntry);
-
-        while (&CacheBlock->ListEntry != &CacheDrive->CacheBlockHead)
+        if (CacheBlock->BlockNumber == BlockNumber)
         {
-            //
-            // We found the block, so return it
-            //
-            if (CacheBlock->BlockNumber == BlockNumber)
-            {
-                //
-                // Increment the blocks access count
-                //
-                CacheBlock->AccessCount++;
-
-                return CacheBlock;
-            }
-
-            CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
+            return CacheBlock;
         }
     }
 
@@ -128,7 +126,8 @@ PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNu
     RtlCopyMemory(CacheBlock->BlockData, DiskReadBuffer, CacheDrive->BlockSize * CacheDrive->BytesPerSector);
 
     // Add it to our list of blocks managed by the cache
-    InsertTailList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+    InsertHeadList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+    InsertHeadList(CacheInternalHashBucket(CacheDrive, BlockNumber), &CacheBlock->HashEntry);
 
     // Update the cache data
     CacheBlockCount++;
@@ -156,12 +155,13 @@ BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 
     // No blocks left in cache that can be freed
     // so just return
-    if (IsListEmpty(&CacheDrive->CacheBlockHead))
+    if (&CacheBlockToFree->ListEntry == &CacheDrive->CacheBlockHead)
     {
         return FALSE;
     }
 
     RemoveEntryList(&CacheBlockToFree->ListEntry);
+    RemoveEntryList(&CacheBlockToFree->HashEntry);
 
     // Free the block memory and the block structure
     FrLdrTempFree(CacheBlockToFree->BlockData, TAG_CACHE_DATA);
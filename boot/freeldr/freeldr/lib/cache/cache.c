@@ -38,6 +38,7 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
 {
     PCACHE_BLOCK    NextCacheBlock;
     GEOMETRY    DriveGeometry;
+    ULONG        Idx;
 
     // If we already have a cache for this drive then
     // by all means lets keep it, unless it is a removable
@@ -80,6 +81,10 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     // Initialize the structure
     RtlZeroMemory(&CacheManagerDrive, sizeof(CACHE_DRIVE));
     InitializeListHead(&CacheManagerDrive.CacheBlockHead);
+    for (Idx = 0; Idx < CACHE_HASH_BUCKETS; Idx++)
+    {
+        InitializeListHead(&CacheManagerDrive.CacheHashTable[Idx]);
+    }
     CacheManagerDrive.DriveNumber = DriveNumber;
     if (!MachDiskGetDriveGeometry(DriveNumber, &DriveGeometry))
     {
@@ -458,6 +458,26 @@ PeLdrpScanImportAddressTable(
 }
 
 
+/* Returns the number of bytes of a section to be loaded from the file */
+static ULONG
+PeLdrpGetSectionRawSize(
+    IN PIMAGE_SECTION_HEADER SectionHeader)
+{
+    ULONG VirtualSize = SectionHeader->Misc.VirtualSize;
+    ULONG SizeOfRawData = SectionHeader->SizeOfRawData;
+
+    /* If PointerToRawData is 0, then force its size to be also 0 */
+    if (SectionHeader->PointerToRawData == 0)
+        return 0;
+
+    /* Cut the loaded size to the VirtualSize extents */
+    if (VirtualSize != 0 && SizeOfRawData > VirtualSize)
+        SizeOfRawData = VirtualSize;
+
+    return SizeOfRawData;
+}
+
+
 /* FUNCTIONS *****************************************************************/
 
 /* Returns TRUE if DLL has already been loaded - looks in LoadOrderList in LPB */
@@ -710,9 +730,10 @@ PeLdrLoadImage(
     PIMAGE_NT_HEADERS NtHeaders;
     PIMAGE_SECTION_HEADER SectionHeader;
     ULONG VirtualSize, SizeOfRawData, NumberOfSections;
+    ULONG HeadersSize, RunStart, RunEnd;
     ARC_STATUS Status;
     LARGE_INTEGER Position;
-    ULONG i, BytesRead;
+    ULONG i, j, BytesRead;
 
     TRACE("PeLdrLoadImage(%s, %ld, *)\n", FileName, MemoryType);
 
@@ -781,24 +802,22 @@ PeLdrLoadImage(
 
     TRACE("Base PA: 0x%X, VA: 0x%X\n", PhysicalBase, VirtualBase);
 
-    /* Set to 0 position and fully load the file image */
-    Position.QuadPart = 0;
-    Status = ArcSeek(FileId, &Position, SeekAbsolute);
-    if (Status != ESUCCESS)
+    /* The first sectors of the headers are already in memory, only read the rest */
+    HeadersSize = min(BytesRead, NtHeaders->OptionalHeader.SizeOfHeaders);
+    RtlCopyMemory(PhysicalBase, HeadersBuffer, HeadersSize);
+    if (HeadersSize < NtHeaders->OptionalHeader.SizeOfHeaders)
     {
-        ERR("ArcSeek(File: '%s') failed. Status: 0x%lx\n", FileName, Status);
-        UiMessageBox("Error seeking the start of a file.");
-        ArcClose(FileId);
-        return FALSE;
-    }
-
-    Status = ArcRead(FileId, PhysicalBase, NtHeaders->OptionalHeader.SizeOfHeaders, &BytesRead);
-    if (Status != ESUCCESS)
-    {
-        ERR("ArcRead(File: '%s') failed. Status: %u\n", FileName, Status);
-        UiMessageBox("Error reading headers.");
-        ArcClose(FileId);
-        return FALSE;
+        Status = ArcRead(FileId,
+                         (PUCHAR)PhysicalBase + HeadersSize,
+                         NtHeaders->OptionalHeader.SizeOfHeaders - HeadersSize,
+                         &BytesRead);
+        if (Status != ESUCCESS)
+        {
+            ERR("ArcRead(File: '%s') failed. Status: %u\n", FileName, Status);
+            UiMessageBox("Error reading headers.");
+            ArcClose(FileId);
+            return FALSE;
+        }
     }
 
     /*
@@ -817,54 +836,68 @@ PeLdrLoadImage(
     *ImageBasePA = PhysicalBase;
 
     /* Walk through each section and read it (check/fix any possible
-       bad situations, if they arise) */
-    for (i = 0; i < NumberOfSections; i++)
-    {
-        VirtualSize = SectionHeader->Misc.VirtualSize;
-        SizeOfRawData = SectionHeader->SizeOfRawData;
-
-        /* Handle a case when VirtualSize equals 0 */
-        if (VirtualSize == 0)
-            VirtualSize = SizeOfRawData;
-
-        /* If PointerToRawData is 0, then force its size to be also 0 */
-        if (SectionHeader->PointerToRawData == 0)
+       bad situations, if they arise). Consecutive sections laid out in
+       the file the same way as in memory are read with a single call. */
+    Status = ESUCCESS;
+    for (i = 0; i < NumberOfSections; i = j)
+    {
+        /* Find the run of sections starting with this one */
+        RunStart = SectionHeader[i].PointerToRawData;
+        RunEnd = RunStart + PeLdrpGetSectionRawSize(&SectionHeader[i]);
+        for (j = i + 1; j < NumberOfSections && RunEnd != RunStart; j++)
         {
-            SizeOfRawData = 0;
-        }
-        else
-        {
-            /* Cut the loaded size to the VirtualSize extents */
-            if (SizeOfRawData > VirtualSize)
-                SizeOfRawData = VirtualSize;
+            SizeOfRawData = PeLdrpGetSectionRawSize(&SectionHeader[j]);
+            if ((SizeOfRawData == 0) ||
+                (SectionHeader[j].PointerToRawData < RunEnd) ||
+                (SectionHeader[j].PointerToRawData - RunStart !=
+                 SectionHeader[j].VirtualAddress - SectionHeader[i].VirtualAddress))
+            {
+                break;
+            }
+            RunEnd = SectionHeader[j].PointerToRawData + SizeOfRawData;
         }
 
-        /* Actually read the section (if its size is not 0) */
-        if (SizeOfRawData != 0)
+        /* Actually read the sections (if their size is not 0) */
+        if (RunEnd != RunStart)
         {
+            TRACE("SH->VA: 0x%X, %lu section(s)\n", SectionHeader[i].VirtualAddress, j - i);
+
             /* Seek to the correct position */
-            Position.LowPart = SectionHeader->PointerToRawData;
+            Position.QuadPart = RunStart;
             Status = ArcSeek(FileId, &Position, SeekAbsolute);
 
-            TRACE("SH->VA: 0x%X\n", SectionHeader->VirtualAddress);
-
-            /* Read this section from the file, size = SizeOfRawData */
-            Status = ArcRead(FileId, (PUCHAR)PhysicalBase + SectionHeader->VirtualAddress, SizeOfRawData, &BytesRead);
+            /* Read the sections from the file, size = end of the last raw data */
+            if (Status == ESUCCESS)
+            {
+                Status = ArcRead(FileId,
+                                 (PUCHAR)PhysicalBase + SectionHeader[i].VirtualAddress,
+                                 RunEnd - RunStart,
+                                 &BytesRead);
+            }
             if (Status != ESUCCESS)
             {
                 ERR("PeLdrLoadImage(): Error reading section from file!\n");
                 break;
             }
         }
+    }
+
+    /* Size of data is less than the virtual size - fill up the remainder with zeroes.
+       Done once everything is read, since a run also carries the file padding. */
+    for (i = 0; i < NumberOfSections && Status == ESUCCESS; i++)
+    {
+        VirtualSize = SectionHeader[i].Misc.VirtualSize;
+        SizeOfRawData = PeLdrpGetSectionRawSize(&SectionHeader[i]);
+
+        /* Handle a case when VirtualSize equals 0 */
+        if (VirtualSize == 0)
+            VirtualSize = SizeOfRawData;
 
-        /* Size of data is less than the virtual size - fill up the remainder with zeroes */
         if (SizeOfRawData < VirtualSize)
         {
             TRACE("PeLdrLoadImage(): SORD %d < VS %d\n", SizeOfRawData, VirtualSize);
-            RtlZeroMemory((PVOID)(SectionHeader->VirtualAddress + (ULONG_PTR)PhysicalBase + SizeOfRawData), VirtualSize - SizeOfRawData);
+            RtlZeroMemory((PVOID)(SectionHeader[i].VirtualAddress + (ULONG_PTR)PhysicalBase + SizeOfRawData), VirtualSize - SizeOfRawData);
         }
-
-        SectionHeader++;
     }
 
     /* We are done with the file - close it */
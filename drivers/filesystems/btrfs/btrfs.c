@@ -67,6 +67,8 @@ PDRIVER_OBJECT drvobj;
 PDEVICE_OBJECT master_devobj, busobj;
 #ifndef __REACTOS__
 bool have_sse42 = false, have_sse2 = false;
+#elif defined(__GNUC__) && (defined(_X86_) || defined(_AMD64_))
+bool have_sse42 = false;
 #endif
 uint64_t num_reads = 0;
 LIST_ENTRY uid_map_list, gid_map_list;
@@ -5551,6 +5553,18 @@ static void check_cpu() {
     else
         TRACE("SSE2 is not supported\n");
 }
+#elif defined(__GNUC__) && (defined(_X86_) || defined(_AMD64_))
+static void check_cpu() {
+    int cpuInfo[4];
+
+    __cpuid(cpuInfo, 1);
+    have_sse42 = cpuInfo[2] & (1 << 20);
+
+    if (have_sse42)
+        TRACE("SSE4.2 is supported\n");
+    else
+        TRACE("SSE4.2 not supported\n");
+}
 #endif
 
 #ifdef _DEBUG
@@ -5812,7 +5826,7 @@ NTSTATUS __stdcall DriverEntry(_In_ PDRIVER_OBJECT DriverObject, _In_ PUNICODE_S
 
     TRACE("DriverEntry\n");
 
-#ifndef __REACTOS__
+#if !defined(__REACTOS__) || (defined(__GNUC__) && (defined(_X86_) || defined(_AMD64_)))
     check_cpu();
 #endif
 
@@ -611,16 +611,33 @@ typedef struct {
     LIST_ENTRY list_entry;
 } sys_chunk;
 
+typedef enum {
+    calc_thread_crc32c,
+    calc_thread_comp,
+    calc_thread_decomp
+} calc_thread_type;
+
 typedef struct {
-    uint8_t* data;
-    uint32_t* csum;
-    uint32_t sectors;
+    calc_thread_type type;
+    uint8_t* in;
+    void* out;
+    uint32_t inlen; // number of sectors for calc_thread_crc32c
+    uint32_t outlen;
+    uint32_t off; // inpageoff for LZO decompression
+    uint8_t compression;
+    unsigned int space_left;
+    NTSTATUS Status;
+    LONG parts;
     LONG pos, done;
     KEVENT event;
     LONG refcount;
     LIST_ENTRY list_entry;
 } calc_job;
 
+// How many (de)compression jobs a read or write keeps queued for each calc thread, so that they
+// don't run dry while we're dealing with the previous one
+#define COMP_PARTS_PER_THREAD 2
+
 typedef struct {
     PDEVICE_OBJECT DeviceObject;
     HANDLE handle;
@@ -1491,7 +1508,13 @@ void watch_registry(HANDLE regh);
 NTSTATUS zlib_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen);
 NTSTATUS lzo_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t inpageoff);
 NTSTATUS zstd_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen);
-NTSTATUS write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, bool* compressed, PIRP Irp, LIST_ENTRY* rollback);
+NTSTATUS zlib_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int level, unsigned int* space_left);
+NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int* space_left);
+NTSTATUS zstd_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t level, unsigned int* space_left);
+uint32_t compress_buffer_size(uint8_t compression, uint32_t inlen);
+uint8_t get_compression_type(fcb* fcb);
+NTSTATUS write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, uint8_t compression, uint8_t* comp_data,
+                              unsigned int space_left, bool* compressed, PIRP Irp, LIST_ENTRY* rollback);
 
 // in galois.c
 void galois_double(uint8_t* data, uint32_t len);
@@ -1512,6 +1535,10 @@ _Function_class_(KSTART_ROUTINE)
 void __stdcall calc_thread(void* context);
 
 NTSTATUS add_calc_job(device_extension* Vcb, uint8_t* data, uint32_t sectors, uint32_t* csum, calc_job** pcj);
+NTSTATUS add_calc_job_comp(device_extension* Vcb, uint8_t compression, uint8_t* in, uint32_t inlen, uint8_t* out, uint32_t outlen, calc_job** pcj);
+NTSTATUS add_calc_job_decomp(device_extension* Vcb, uint8_t compression, uint8_t* in, uint32_t inlen, uint8_t* out, uint32_t outlen,
+                             uint32_t inpageoff, calc_job** pcj);
+bool do_calc_job(device_extension* Vcb, calc_job* cj);
 void free_calc_job(calc_job* cj);
 
 // in balance.c
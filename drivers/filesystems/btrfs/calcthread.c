@@ -19,21 +19,11 @@
 
 #define SECTOR_BLOCK 16
 
-NTSTATUS add_calc_job(device_extension* Vcb, uint8_t* data, uint32_t sectors, uint32_t* csum, calc_job** pcj) {
-    calc_job* cj;
-
-    cj = ExAllocatePoolWithTag(NonPagedPool, sizeof(calc_job), ALLOC_TAG);
-    if (!cj) {
-        ERR("out of memory\n");
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
-
-    cj->data = data;
-    cj->sectors = sectors;
-    cj->csum = csum;
+static void queue_calc_job(device_extension* Vcb, calc_job* cj) {
     cj->pos = 0;
     cj->done = 0;
     cj->refcount = 1;
+    cj->Status = STATUS_SUCCESS;
     KeInitializeEvent(&cj->event, NotificationEvent, false);
 
     ExAcquireResourceExclusiveLite(&Vcb->calcthreads.lock, true);
@@ -44,6 +34,75 @@ NTSTATUS add_calc_job(device_extension* Vcb, uint8_t* data, uint32_t sectors, ui
     KeClearEvent(&Vcb->calcthreads.event);
 
     ExReleaseResourceLite(&Vcb->calcthreads.lock);
+}
+
+NTSTATUS add_calc_job(device_extension* Vcb, uint8_t* data, uint32_t sectors, uint32_t* csum, calc_job** pcj) {
+    calc_job* cj;
+
+    cj = ExAllocatePoolWithTag(NonPagedPool, sizeof(calc_job), ALLOC_TAG);
+    if (!cj) {
+        ERR("out of memory\n");
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    cj->type = calc_thread_crc32c;
+    cj->in = data;
+    cj->out = csum;
+    cj->inlen = sectors;
+    cj->parts = (sectors + SECTOR_BLOCK - 1) / SECTOR_BLOCK;
+
+    queue_calc_job(Vcb, cj);
+
+    *pcj = cj;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS add_calc_job_comp(device_extension* Vcb, uint8_t compression, uint8_t* in, uint32_t inlen, uint8_t* out, uint32_t outlen, calc_job** pcj) {
+    calc_job* cj;
+
+    cj = ExAllocatePoolWithTag(NonPagedPool, sizeof(calc_job), ALLOC_TAG);
+    if (!cj) {
+        ERR("out of memory\n");
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    cj->type = calc_thread_comp;
+    cj->compression = compression;
+    cj->in = in;
+    cj->inlen = inlen;
+    cj->out = out;
+    cj->outlen = outlen;
+    cj->space_left = 0;
+    cj->parts = 1;
+
+    queue_calc_job(Vcb, cj);
+
+    *pcj = cj;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS add_calc_job_decomp(device_extension* Vcb, uint8_t compression, uint8_t* in, uint32_t inlen, uint8_t* out, uint32_t outlen,
+                             uint32_t inpageoff, calc_job** pcj) {
+    calc_job* cj;
+
+    cj = ExAllocatePoolWithTag(NonPagedPool, sizeof(calc_job), ALLOC_TAG);
+    if (!cj) {
+        ERR("out of memory\n");
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    cj->type = calc_thread_decomp;
+    cj->compression = compression;
+    cj->in = in;
+    cj->inlen = inlen;
+    cj->out = out;
+    cj->outlen = outlen;
+    cj->off = inpageoff;
+    cj->parts = 1;
+
+    queue_calc_job(Vcb, cj);
 
     *pcj = cj;
 
@@ -57,37 +116,100 @@ void free_calc_job(calc_job* cj) {
         ExFreePool(cj);
 }
 
-static bool do_calc(device_extension* Vcb, calc_job* cj) {
-    LONG pos, done;
+static void calc_crc32c_part(device_extension* Vcb, calc_job* cj, LONG pos) {
     uint32_t* csum;
     uint8_t* data;
     ULONG blocksize, i;
 
-    pos = InterlockedIncrement(&cj->pos) - 1;
-
-    if ((uint32_t)pos * SECTOR_BLOCK >= cj->sectors)
-        return false;
+    csum = &((uint32_t*)cj->out)[pos * SECTOR_BLOCK];
+    data = cj->in + (pos * SECTOR_BLOCK * Vcb->superblock.sector_size);
 
-    csum = &cj->csum[pos * SECTOR_BLOCK];
-    data = cj->data + (pos * SECTOR_BLOCK * Vcb->superblock.sector_size);
-
-    blocksize = min(SECTOR_BLOCK, cj->sectors - (pos * SECTOR_BLOCK));
+    blocksize = min(SECTOR_BLOCK, cj->inlen - (pos * SECTOR_BLOCK));
     for (i = 0; i < blocksize; i++) {
         *csum = ~calc_crc32c(0xffffffff, data, Vcb->superblock.sector_size);
         csum++;
         data += Vcb->superblock.sector_size;
     }
+}
 
-    done = InterlockedIncrement(&cj->done);
+static NTSTATUS calc_comp(device_extension* Vcb, calc_job* cj) {
+    switch (cj->compression) {
+        case BTRFS_COMPRESSION_ZLIB:
+            return zlib_compress(cj->in, cj->inlen, cj->out, cj->outlen, Vcb->options.zlib_level, &cj->space_left);
+
+        case BTRFS_COMPRESSION_LZO:
+            return lzo_compress(cj->in, cj->inlen, cj->out, cj->outlen, &cj->space_left);
+
+        case BTRFS_COMPRESSION_ZSTD:
+            return zstd_compress(cj->in, cj->inlen, cj->out, cj->outlen, Vcb->options.zstd_level, &cj->space_left);
+
+        default:
+            ERR("unsupported compression type %x\n", cj->compression);
+            return STATUS_NOT_SUPPORTED;
+    }
+}
+
+static NTSTATUS calc_decomp(calc_job* cj) {
+    switch (cj->compression) {
+        case BTRFS_COMPRESSION_ZLIB:
+            return zlib_decompress(cj->in, cj->inlen, cj->out, cj->outlen);
+
+        case BTRFS_COMPRESSION_LZO:
+            return lzo_decompress(cj->in, cj->inlen, cj->out, cj->outlen, cj->off);
+
+        case BTRFS_COMPRESSION_ZSTD:
+            return zstd_decompress(cj->in, cj->inlen, cj->out, cj->outlen);
+
+        default:
+            ERR("unsupported compression type %x\n", cj->compression);
+            return STATUS_NOT_SUPPORTED;
+    }
+}
 
-    if ((uint32_t)done * SECTOR_BLOCK >= cj->sectors) {
+// Does one part of the job, if there's any left. This is called by the calc threads, but also
+// by the thread which queued the job, so that it does something useful while it waits.
+bool do_calc_job(device_extension* Vcb, calc_job* cj) {
+    LONG pos, done;
+    NTSTATUS Status;
+
+    pos = InterlockedIncrement(&cj->pos) - 1;
+
+    if (pos >= cj->parts)
+        return false;
+
+    // Take the job off the queue as soon as its last part has been claimed,
+    // so that idle threads can move straight on to the next one. A calc thread
+    // may have got there first, in which case the entry points to itself.
+    if (pos == cj->parts - 1) {
         ExAcquireResourceExclusiveLite(&Vcb->calcthreads.lock, true);
         RemoveEntryList(&cj->list_entry);
+        InitializeListHead(&cj->list_entry);
         ExReleaseResourceLite(&Vcb->calcthreads.lock);
+    }
 
-        KeSetEvent(&cj->event, 0, false);
+    switch (cj->type) {
+        case calc_thread_crc32c:
+            calc_crc32c_part(Vcb, cj, pos);
+            break;
+
+        case calc_thread_comp:
+            Status = calc_comp(Vcb, cj);
+            if (!NT_SUCCESS(Status))
+                cj->Status = Status;
+            break;
+
+        case calc_thread_decomp:
+            Status = calc_decomp(cj);
+            if (!NT_SUCCESS(Status))
+                cj->Status = Status;
+            break;
     }
 
+    done = InterlockedIncrement(&cj->done);
+
+    if (done == cj->parts)
+        KeSetEvent(&cj->event, 0, false);
+
     return true;
 }
 
@@ -103,7 +225,6 @@ void __stdcall calc_thread(void* context) {
 
         while (true) {
             calc_job* cj;
-            bool b;
 
             ExAcquireResourceExclusiveLite(&Vcb->calcthreads.lock, true);
 
@@ -113,16 +234,23 @@ void __stdcall calc_thread(void* context) {
             }
 
             cj = CONTAINING_RECORD(Vcb->calcthreads.job_list.Flink, calc_job, list_entry);
-            cj->refcount++;
+
+            // If another thread has just claimed the last part of this job, take it
+            // off the queue ourselves rather than spinning until that thread does.
+            if (cj->pos >= cj->parts) {
+                RemoveEntryList(&cj->list_entry);
+                InitializeListHead(&cj->list_entry);
+                ExReleaseResourceLite(&Vcb->calcthreads.lock);
+                continue;
+            }
+
+            InterlockedIncrement(&cj->refcount);
 
             ExReleaseResourceLite(&Vcb->calcthreads.lock);
 
-            b = do_calc(Vcb, cj);
+            do_calc_job(Vcb, cj);
 
             free_calc_job(cj);
-
-            if (!b)
-                break;
         }
 
         if (thread->quit)
@@ -379,151 +379,46 @@ NTSTATUS zlib_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32
     return STATUS_SUCCESS;
 }
 
-static NTSTATUS zlib_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, bool* compressed, PIRP Irp, LIST_ENTRY* rollback) {
-    NTSTATUS Status;
-    uint8_t compression;
-    uint32_t comp_length;
-    uint8_t* comp_data;
-    uint32_t out_left;
-    LIST_ENTRY* le;
-    chunk* c;
+NTSTATUS zlib_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int level, unsigned int* space_left) {
     z_stream c_stream;
     int ret;
 
-    comp_data = ExAllocatePoolWithTag(PagedPool, (uint32_t)(end_data - start_data), ALLOC_TAG);
-    if (!comp_data) {
-        ERR("out of memory\n");
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
-
-    Status = excise_extents(fcb->Vcb, fcb, start_data, end_data, Irp, rollback);
-    if (!NT_SUCCESS(Status)) {
-        ERR("excise_extents returned %08x\n", Status);
-        ExFreePool(comp_data);
-        return Status;
-    }
-
     c_stream.zalloc = zlib_alloc;
     c_stream.zfree = zlib_free;
     c_stream.opaque = (voidpf)0;
 
-    ret = deflateInit(&c_stream, fcb->Vcb->options.zlib_level);
+    ret = deflateInit(&c_stream, level);
 
     if (ret != Z_OK) {
         ERR("deflateInit returned %08x\n", ret);
-        ExFreePool(comp_data);
         return STATUS_INTERNAL_ERROR;
     }
 
-    c_stream.avail_in = (uint32_t)(end_data - start_data);
-    c_stream.next_in = data;
-    c_stream.avail_out = (uint32_t)(end_data - start_data);
-    c_stream.next_out = comp_data;
+    c_stream.avail_in = inlen;
+    c_stream.next_in = inbuf;
+    c_stream.avail_out = outlen;
+    c_stream.next_out = outbuf;
 
     do {
         ret = deflate(&c_stream, Z_FINISH);
 
         if (ret == Z_STREAM_ERROR) {
             ERR("deflate returned %x\n", ret);
-            ExFreePool(comp_data);
+            deflateEnd(&c_stream);
             return STATUS_INTERNAL_ERROR;
         }
     } while (c_stream.avail_in > 0 && c_stream.avail_out > 0);
 
-    out_left = c_stream.avail_out;
+    *space_left = c_stream.avail_in > 0 ? 0 : c_stream.avail_out;
 
     ret = deflateEnd(&c_stream);
 
-    if (ret != Z_OK) {
+    if (ret != Z_OK && ret != Z_DATA_ERROR) { // Z_DATA_ERROR means we ran out of space, which isn't fatal
         ERR("deflateEnd returned %08x\n", ret);
-        ExFreePool(comp_data);
         return STATUS_INTERNAL_ERROR;
     }
 
-    if (out_left < fcb->Vcb->superblock.sector_size) { // compressed extent would be larger than or same size as uncompressed extent
-        ExFreePool(comp_data);
-
-        comp_length = (uint32_t)(end_data - start_data);
-        comp_data = data;
-        compression = BTRFS_COMPRESSION_NONE;
-
-        *compressed = false;
-    } else {
-        uint32_t cl;
-
-        compression = BTRFS_COMPRESSION_ZLIB;
-        cl = (uint32_t)(end_data - start_data - out_left);
-        comp_length = (uint32_t)sector_align(cl, fcb->Vcb->superblock.sector_size);
-
-        RtlZeroMemory(comp_data + cl, comp_length - cl);
-
-        *compressed = true;
-    }
-
-    ExAcquireResourceSharedLite(&fcb->Vcb->chunk_lock, true);
-
-    le = fcb->Vcb->chunks.Flink;
-    while (le != &fcb->Vcb->chunks) {
-        c = CONTAINING_RECORD(le, chunk, list_entry);
-
-        if (!c->readonly && !c->reloc) {
-            acquire_chunk_lock(c, fcb->Vcb);
-
-            if (c->chunk_item->type == fcb->Vcb->data_flags && (c->chunk_item->size - c->used) >= comp_length) {
-                if (insert_extent_chunk(fcb->Vcb, fcb, c, start_data, comp_length, false, comp_data, Irp, rollback, compression, end_data - start_data, false, 0)) {
-                    ExReleaseResourceLite(&fcb->Vcb->chunk_lock);
-
-                    if (compression != BTRFS_COMPRESSION_NONE)
-                        ExFreePool(comp_data);
-
-                    return STATUS_SUCCESS;
-                }
-            }
-
-            release_chunk_lock(c, fcb->Vcb);
-        }
-
-        le = le->Flink;
-    }
-
-    ExReleaseResourceLite(&fcb->Vcb->chunk_lock);
-
-    ExAcquireResourceExclusiveLite(&fcb->Vcb->chunk_lock, true);
-
-    Status = alloc_chunk(fcb->Vcb, fcb->Vcb->data_flags, &c, false);
-
-    ExReleaseResourceLite(&fcb->Vcb->chunk_lock);
-
-    if (!NT_SUCCESS(Status)) {
-        ERR("alloc_chunk returned %08x\n", Status);
-
-        if (compression != BTRFS_COMPRESSION_NONE)
-            ExFreePool(comp_data);
-
-        return Status;
-    }
-
-    if (c) {
-        acquire_chunk_lock(c, fcb->Vcb);
-
-        if (c->chunk_item->type == fcb->Vcb->data_flags && (c->chunk_item->size - c->used) >= comp_length) {
-            if (insert_extent_chunk(fcb->Vcb, fcb, c, start_data, comp_length, false, comp_data, Irp, rollback, compression, end_data - start_data, false, 0)) {
-                if (compression != BTRFS_COMPRESSION_NONE)
-                    ExFreePool(comp_data);
-
-                return STATUS_SUCCESS;
-            }
-        }
-
-        release_chunk_lock(c, fcb->Vcb);
-    }
-
-    WARN("couldn't find any data chunks with %I64x bytes free\n", comp_length);
-
-    if (compression != BTRFS_COMPRESSION_NONE)
-        ExFreePool(comp_data);
-
-    return STATUS_DISK_FULL;
+    return STATUS_SUCCESS;
 }
 
 static NTSTATUS lzo_do_compress(const uint8_t* in, uint32_t in_len, uint8_t* out, uint32_t* out_len, void* wrkmem) {
@@ -767,63 +662,42 @@ static __inline uint32_t lzo_max_outlen(uint32_t inlen) {
     return inlen + (inlen / 16) + 64 + 3; // formula comes from LZO.FAQ
 }
 
-static NTSTATUS lzo_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, bool* compressed, PIRP Irp, LIST_ENTRY* rollback) {
+NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int* space_left) {
     NTSTATUS Status;
-    uint8_t compression;
-    uint64_t comp_length;
-    ULONG comp_data_len, num_pages, i;
-    uint8_t* comp_data;
-    bool skip_compression = false;
+    unsigned int num_pages, i;
     lzo_stream stream;
     uint32_t* out_size;
-    LIST_ENTRY* le;
-    chunk* c;
-
-    num_pages = (ULONG)((sector_align(end_data - start_data, LZO_PAGE_SIZE)) / LZO_PAGE_SIZE);
 
-    // Four-byte overall header
-    // Another four-byte header page
-    // Each page has a maximum size of lzo_max_outlen(LZO_PAGE_SIZE)
-    // Plus another four bytes for possible padding
-    comp_data_len = sizeof(uint32_t) + ((lzo_max_outlen(LZO_PAGE_SIZE) + (2 * sizeof(uint32_t))) * num_pages);
-
-    comp_data = ExAllocatePoolWithTag(PagedPool, comp_data_len, ALLOC_TAG);
-    if (!comp_data) {
-        ERR("out of memory\n");
-        return STATUS_INSUFFICIENT_RESOURCES;
+    if (outlen < compress_buffer_size(BTRFS_COMPRESSION_LZO, inlen)) {
+        ERR("output buffer too small (%x < %x)\n", outlen, compress_buffer_size(BTRFS_COMPRESSION_LZO, inlen));
+        return STATUS_BUFFER_TOO_SMALL;
     }
 
+    num_pages = (unsigned int)((sector_align(inlen, LZO_PAGE_SIZE)) / LZO_PAGE_SIZE);
+
     stream.wrkmem = ExAllocatePoolWithTag(PagedPool, LZO1X_MEM_COMPRESS, ALLOC_TAG);
     if (!stream.wrkmem) {
         ERR("out of memory\n");
-        ExFreePool(comp_data);
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    Status = excise_extents(fcb->Vcb, fcb, start_data, end_data, Irp, rollback);
-    if (!NT_SUCCESS(Status)) {
-        ERR("excise_extents returned %08x\n", Status);
-        ExFreePool(comp_data);
-        ExFreePool(stream.wrkmem);
-        return Status;
-    }
-
-    out_size = (uint32_t*)comp_data;
+    out_size = (uint32_t*)outbuf;
     *out_size = sizeof(uint32_t);
 
-    stream.in = data;
-    stream.out = comp_data + (2 * sizeof(uint32_t));
+    stream.in = inbuf;
+    stream.out = outbuf + (2 * sizeof(uint32_t));
 
     for (i = 0; i < num_pages; i++) {
         uint32_t* pagelen = (uint32_t*)(stream.out - sizeof(uint32_t));
 
-        stream.inlen = (uint32_t)min(LZO_PAGE_SIZE, end_data - start_data - (i * LZO_PAGE_SIZE));
+        stream.inlen = (uint32_t)min(LZO_PAGE_SIZE, inlen - (i * LZO_PAGE_SIZE));
 
         Status = lzo1x_1_compress(&stream);
         if (!NT_SUCCESS(Status)) {
             ERR("lzo1x_1_compress returned %08x\n", Status);
-            skip_compression = true;
-            break;
+            ExFreePool(stream.wrkmem);
+            *space_left = 0; // store uncompressed
+            return STATUS_SUCCESS;
         }
 
         *pagelen = stream.outlen;
@@ -841,144 +715,44 @@ static NTSTATUS lzo_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_t
 
     ExFreePool(stream.wrkmem);
 
-    if (skip_compression || *out_size >= end_data - start_data - fcb->Vcb->superblock.sector_size) { // compressed extent would be larger than or same size as uncompressed extent
-        ExFreePool(comp_data);
-
-        comp_length = end_data - start_data;
-        comp_data = data;
-        compression = BTRFS_COMPRESSION_NONE;
-
-        *compressed = false;
-    } else {
-        compression = BTRFS_COMPRESSION_LZO;
-        comp_length = sector_align(*out_size, fcb->Vcb->superblock.sector_size);
-
-        RtlZeroMemory(comp_data + *out_size, (ULONG)(comp_length - *out_size));
-
-        *compressed = true;
-    }
-
-    ExAcquireResourceSharedLite(&fcb->Vcb->chunk_lock, true);
-
-    le = fcb->Vcb->chunks.Flink;
-    while (le != &fcb->Vcb->chunks) {
-        c = CONTAINING_RECORD(le, chunk, list_entry);
-
-        if (!c->readonly && !c->reloc) {
-            acquire_chunk_lock(c, fcb->Vcb);
-
-            if (c->chunk_item->type == fcb->Vcb->data_flags && (c->chunk_item->size - c->used) >= comp_length) {
-                if (insert_extent_chunk(fcb->Vcb, fcb, c, start_data, comp_length, false, comp_data, Irp, rollback, compression, end_data - start_data, false, 0)) {
-                    ExReleaseResourceLite(&fcb->Vcb->chunk_lock);
-
-                    if (compression != BTRFS_COMPRESSION_NONE)
-                        ExFreePool(comp_data);
-
-                    return STATUS_SUCCESS;
-                }
-            }
-
-            release_chunk_lock(c, fcb->Vcb);
-        }
-
-        le = le->Flink;
-    }
-
-    ExReleaseResourceLite(&fcb->Vcb->chunk_lock);
-
-    ExAcquireResourceExclusiveLite(&fcb->Vcb->chunk_lock, true);
-
-    Status = alloc_chunk(fcb->Vcb, fcb->Vcb->data_flags, &c, false);
-
-    ExReleaseResourceLite(&fcb->Vcb->chunk_lock);
-
-    if (!NT_SUCCESS(Status)) {
-        ERR("alloc_chunk returned %08x\n", Status);
-
-        if (compression != BTRFS_COMPRESSION_NONE)
-            ExFreePool(comp_data);
-
-        return Status;
-    }
-
-    if (c) {
-        acquire_chunk_lock(c, fcb->Vcb);
-
-        if (c->chunk_item->type == fcb->Vcb->data_flags && (c->chunk_item->size - c->used) >= comp_length) {
-            if (insert_extent_chunk(fcb->Vcb, fcb, c, start_data, comp_length, false, comp_data, Irp, rollback, compression, end_data - start_data, false, 0)) {
-                if (compression != BTRFS_COMPRESSION_NONE)
-                    ExFreePool(comp_data);
-
-                return STATUS_SUCCESS;
-            }
-        }
-
-        release_chunk_lock(c, fcb->Vcb);
-    }
+    *space_left = *out_size < inlen ? inlen - *out_size : 0;
 
-    WARN("couldn't find any data chunks with %I64x bytes free\n", comp_length);
-
-    if (compression != BTRFS_COMPRESSION_NONE)
-        ExFreePool(comp_data);
-
-    return STATUS_DISK_FULL;
+    return STATUS_SUCCESS;
 }
 
-static NTSTATUS zstd_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, bool* compressed, PIRP Irp, LIST_ENTRY* rollback) {
-    NTSTATUS Status;
-    uint8_t compression;
-    uint32_t comp_length;
-    uint8_t* comp_data;
-    uint32_t out_left;
-    LIST_ENTRY* le;
-    chunk* c;
+NTSTATUS zstd_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t level, unsigned int* space_left) {
     ZSTD_CStream* stream;
     size_t init_res, written;
     ZSTD_inBuffer input;
     ZSTD_outBuffer output;
     ZSTD_parameters params;
 
-    comp_data = ExAllocatePoolWithTag(PagedPool, (uint32_t)(end_data - start_data), ALLOC_TAG);
-    if (!comp_data) {
-        ERR("out of memory\n");
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
-
-    Status = excise_extents(fcb->Vcb, fcb, start_data, end_data, Irp, rollback);
-    if (!NT_SUCCESS(Status)) {
-        ERR("excise_extents returned %08x\n", Status);
-        ExFreePool(comp_data);
-        return Status;
-    }
-
     stream = ZSTD_createCStream_advanced(zstd_mem);
 
     if (!stream) {
         ERR("ZSTD_createCStream failed.\n");
-        ExFreePool(comp_data);
         return STATUS_INTERNAL_ERROR;
     }
 
-    params = ZSTD_getParams(fcb->Vcb->options.zstd_level, (uint32_t)(end_data - start_data), 0);
+    params = ZSTD_getParams(level, inlen, 0);
 
     if (params.cParams.windowLog > ZSTD_BTRFS_MAX_WINDOWLOG)
         params.cParams.windowLog = ZSTD_BTRFS_MAX_WINDOWLOG;
 
-    init_res = ZSTD_initCStream_advanced(stream, NULL, 0, params, (uint32_t)(end_data - start_data));
+    init_res = ZSTD_initCStream_advanced(stream, NULL, 0, params, inlen);
 
     if (ZSTD_isError(init_res)) {
         ERR("ZSTD_initCStream_advanced failed: %s\n", ZSTD_getErrorName(init_res));
         ZSTD_freeCStream(stream);
-        ExFreePool(comp_data);
         return STATUS_INTERNAL_ERROR;
     }
 
-    input.src = data;
-    input.size = (uint32_t)(end_data - start_data);
+    input.src = inbuf;
+    input.size = inlen;
     input.pos = 0;
 
-    output.dst = comp_data;
-    output.size = (uint32_t)(end_data - start_data);
+    output.dst = outbuf;
+    output.size = outlen;
     output.pos = 0;
 
     while (input.pos < input.size && output.pos < output.size) {
@@ -987,7 +761,6 @@ static NTSTATUS zstd_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_
         if (ZSTD_isError(written)) {
             ERR("ZSTD_compressStream failed: %s\n", ZSTD_getErrorName(written));
             ZSTD_freeCStream(stream);
-            ExFreePool(comp_data);
             return STATUS_INTERNAL_ERROR;
         }
     }
@@ -996,30 +769,84 @@ static NTSTATUS zstd_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_
     if (ZSTD_isError(written)) {
         ERR("ZSTD_endStream failed: %s\n", ZSTD_getErrorName(written));
         ZSTD_freeCStream(stream);
-        ExFreePool(comp_data);
         return STATUS_INTERNAL_ERROR;
     }
 
     ZSTD_freeCStream(stream);
 
-    out_left = output.size - output.pos;
+    // a non-zero return from ZSTD_endStream means the frame didn't fit
+    *space_left = written > 0 ? 0 : (unsigned int)(output.size - output.pos);
+
+    return STATUS_SUCCESS;
+}
+
+uint32_t compress_buffer_size(uint8_t compression, uint32_t inlen) {
+    if (compression == BTRFS_COMPRESSION_LZO) {
+        uint32_t num_pages = (uint32_t)(sector_align(inlen, LZO_PAGE_SIZE) / LZO_PAGE_SIZE);
+
+        // Four-byte overall header
+        // Another four-byte header page
+        // Each page has a maximum size of lzo_max_outlen(LZO_PAGE_SIZE)
+        // Plus another four bytes for possible padding
+        return sizeof(uint32_t) + ((lzo_max_outlen(LZO_PAGE_SIZE) + (2 * sizeof(uint32_t))) * num_pages);
+    }
+
+    // We give up on zlib and zstd as soon as the output is larger than the input
+    return inlen;
+}
+
+uint8_t get_compression_type(fcb* fcb) {
+    uint8_t type;
+
+    if (fcb->Vcb->options.compress_type != 0 && fcb->prop_compression == PropCompression_None)
+        type = fcb->Vcb->options.compress_type;
+    else {
+        if (!(fcb->Vcb->superblock.incompat_flags & BTRFS_INCOMPAT_FLAGS_COMPRESS_ZSTD) && fcb->prop_compression == PropCompression_ZSTD)
+            type = BTRFS_COMPRESSION_ZSTD;
+        else if (fcb->Vcb->superblock.incompat_flags & BTRFS_INCOMPAT_FLAGS_COMPRESS_ZSTD && fcb->prop_compression != PropCompression_Zlib && fcb->prop_compression != PropCompression_LZO)
+            type = BTRFS_COMPRESSION_ZSTD;
+        else if (!(fcb->Vcb->superblock.incompat_flags & BTRFS_INCOMPAT_FLAGS_COMPRESS_LZO) && fcb->prop_compression == PropCompression_LZO)
+            type = BTRFS_COMPRESSION_LZO;
+        else if (fcb->Vcb->superblock.incompat_flags & BTRFS_INCOMPAT_FLAGS_COMPRESS_LZO && fcb->prop_compression != PropCompression_Zlib)
+            type = BTRFS_COMPRESSION_LZO;
+        else
+            type = BTRFS_COMPRESSION_ZLIB;
+    }
+
+    if (type == BTRFS_COMPRESSION_ZSTD)
+        fcb->Vcb->superblock.incompat_flags |= BTRFS_INCOMPAT_FLAGS_COMPRESS_ZSTD;
+    else if (type == BTRFS_COMPRESSION_LZO)
+        fcb->Vcb->superblock.incompat_flags |= BTRFS_INCOMPAT_FLAGS_COMPRESS_LZO;
+
+    return type;
+}
+
+// comp_data is the output of a compression job for data, of which space_left bytes were unused
+NTSTATUS write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, uint8_t compression, uint8_t* comp_data,
+                              unsigned int space_left, bool* compressed, PIRP Irp, LIST_ENTRY* rollback) {
+    NTSTATUS Status;
+    uint64_t comp_length;
+    LIST_ENTRY* le;
+    chunk* c;
 
-    if (out_left < fcb->Vcb->superblock.sector_size) { // compressed extent would be larger than or same size as uncompressed extent
-        ExFreePool(comp_data);
+    Status = excise_extents(fcb->Vcb, fcb, start_data, end_data, Irp, rollback);
+    if (!NT_SUCCESS(Status)) {
+        ERR("excise_extents returned %08x\n", Status);
+        return Status;
+    }
 
-        comp_length = (uint32_t)(end_data - start_data);
+    if (space_left < fcb->Vcb->superblock.sector_size) { // compressed extent would be larger than or same size as uncompressed extent
+        comp_length = end_data - start_data;
         comp_data = data;
         compression = BTRFS_COMPRESSION_NONE;
 
         *compressed = false;
     } else {
-        uint32_t cl;
+        uint32_t cl = (uint32_t)(end_data - start_data - space_left);
 
-        compression = BTRFS_COMPRESSION_ZSTD;
-        cl = (uint32_t)(end_data - start_data - out_left);
-        comp_length = (uint32_t)sector_align(cl, fcb->Vcb->superblock.sector_size);
+        comp_length = sector_align(cl, fcb->Vcb->superblock.sector_size);
 
-        RtlZeroMemory(comp_data + cl, comp_length - cl);
+        RtlZeroMemory(comp_data + cl, (ULONG)(comp_length - cl));
 
         *compressed = true;
     }
@@ -1036,10 +863,6 @@ static NTSTATUS zstd_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_
             if (c->chunk_item->type == fcb->Vcb->data_flags && (c->chunk_item->size - c->used) >= comp_length) {
                 if (insert_extent_chunk(fcb->Vcb, fcb, c, start_data, comp_length, false, comp_data, Irp, rollback, compression, end_data - start_data, false, 0)) {
                     ExReleaseResourceLite(&fcb->Vcb->chunk_lock);
-
-                    if (compression != BTRFS_COMPRESSION_NONE)
-                        ExFreePool(comp_data);
-
                     return STATUS_SUCCESS;
                 }
             }
@@ -1060,10 +883,6 @@ static NTSTATUS zstd_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_
 
     if (!NT_SUCCESS(Status)) {
         ERR("alloc_chunk returned %08x\n", Status);
-
-        if (compression != BTRFS_COMPRESSION_NONE)
-            ExFreePool(comp_data);
-
         return Status;
     }
 
@@ -1071,12 +890,8 @@ static NTSTATUS zstd_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_
         acquire_chunk_lock(c, fcb->Vcb);
 
         if (c->chunk_item->type == fcb->Vcb->data_flags && (c->chunk_item->size - c->used) >= comp_length) {
-            if (insert_extent_chunk(fcb->Vcb, fcb, c, start_data, comp_length, false, comp_data, Irp, rollback, compression, end_data - start_data, false, 0)) {
-                if (compression != BTRFS_COMPRESSION_NONE)
-                    ExFreePool(comp_data);
-
+            if (insert_extent_chunk(fcb->Vcb, fcb, c, start_data, comp_length, false, comp_data, Irp, rollback, compression, end_data - start_data, false, 0))
                 return STATUS_SUCCESS;
-            }
         }
 
         release_chunk_lock(c, fcb->Vcb);
@@ -1084,40 +899,9 @@ static NTSTATUS zstd_write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_
 
     WARN("couldn't find any data chunks with %I64x bytes free\n", comp_length);
 
-    if (compression != BTRFS_COMPRESSION_NONE)
-        ExFreePool(comp_data);
-
     return STATUS_DISK_FULL;
 }
 
-NTSTATUS write_compressed_bit(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, bool* compressed, PIRP Irp, LIST_ENTRY* rollback) {
-    uint8_t type;
-
-    if (fcb->Vcb->options.compress_type != 0 && fcb->prop_compression == PropCompression_None)
-        type = fcb->Vcb->options.compress_type;
-    else {
-        if (!(fcb->Vcb->superblock.incompat_flags & BTRFS_INCOMPAT_FLAGS_COMPRESS_ZSTD) && fcb->prop_compression == PropCompression_ZSTD)
-            type = BTRFS_COMPRESSION_ZSTD;
-        else if (fcb->Vcb->superblock.incompat_flags & BTRFS_INCOMPAT_FLAGS_COMPRESS_ZSTD && fcb->prop_compression != PropCompression_Zlib && fcb->prop_compression != PropCompression_LZO)
-            type = BTRFS_COMPRESSION_ZSTD;
-        else if (!(fcb->Vcb->superblock.incompat_flags & BTRFS_INCOMPAT_FLAGS_COMPRESS_LZO) && fcb->prop_compression == PropCompression_LZO)
-            type = BTRFS_COMPRESSION_LZO;
-        else if (fcb->Vcb->superblock.incompat_flags & BTRFS_INCOMPAT_FLAGS_COMPRESS_LZO && fcb->prop_compression != PropCompression_Zlib)
-            type = BTRFS_COMPRESSION_LZO;
-        else
-            type = BTRFS_COMPRESSION_ZLIB;
-    }
-
-    if (type == BTRFS_COMPRESSION_ZSTD) {
-        fcb->Vcb->superblock.incompat_flags |= BTRFS_INCOMPAT_FLAGS_COMPRESS_ZSTD;
-        return zstd_write_compressed_bit(fcb, start_data, end_data, data, compressed, Irp, rollback);
-    } else if (type == BTRFS_COMPRESSION_LZO) {
-        fcb->Vcb->superblock.incompat_flags |= BTRFS_INCOMPAT_FLAGS_COMPRESS_LZO;
-        return lzo_write_compressed_bit(fcb, start_data, end_data, data, compressed, Irp, rollback);
-    } else
-        return zlib_write_compressed_bit(fcb, start_data, end_data, data, compressed, Irp, rollback);
-}
-
 static void* zstd_malloc(void* opaque, size_t size) {
     UNUSED(opaque);
 
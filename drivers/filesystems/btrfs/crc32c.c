@@ -22,8 +22,43 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-#ifndef __REACTOS__
+#if !defined(__REACTOS__) || (defined(__GNUC__) && (defined(_X86_) || defined(_AMD64_)))
+#define CRC32C_HW
 extern bool have_sse42;
+#endif
+
+#ifdef __REACTOS__
+#ifdef CRC32C_HW
+// We're not built with -msse4.2, so the CRC32 instructions have to be emitted
+// through inline assembly rather than the SSE4.2 intrinsics.
+static __inline uint32_t crc32c_asm_u8(uint32_t crc, uint8_t v) {
+    __asm__("crc32b %1, %0" : "+r" (crc) : "rm" (v));
+    return crc;
+}
+
+static __inline uint32_t crc32c_asm_u16(uint32_t crc, uint16_t v) {
+    __asm__("crc32w %1, %0" : "+r" (crc) : "rm" (v));
+    return crc;
+}
+
+static __inline uint32_t crc32c_asm_u32(uint32_t crc, uint32_t v) {
+    __asm__("crc32l %1, %0" : "+r" (crc) : "rm" (v));
+    return crc;
+}
+
+#ifdef _AMD64_
+static __inline uint64_t crc32c_asm_u64(uint64_t crc, uint64_t v) {
+    __asm__("crc32q %1, %0" : "+r" (crc) : "rm" (v));
+    return crc;
+}
+
+#define _mm_crc32_u64 crc32c_asm_u64
+#endif
+
+#define _mm_crc32_u8 crc32c_asm_u8
+#define _mm_crc32_u16 crc32c_asm_u16
+#define _mm_crc32_u32 crc32c_asm_u32
+#endif /* CRC32C_HW */
 #endif /* __REACTOS__ */
 
 static const uint32_t crctable[] = {
@@ -61,7 +96,7 @@ static const uint32_t crctable[] = {
     0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e, 0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
 };
 
-#ifndef __REACTOS__
+#ifdef CRC32C_HW
 // HW code taken from https://github.com/rurban/smhasher/blob/master/crc32_hw.c
 #define ALIGN_SIZE      0x08UL
 #define ALIGN_MASK      (ALIGN_SIZE - 1)
@@ -117,7 +152,7 @@ uint32_t calc_crc32c(_In_ uint32_t seed, _In_reads_bytes_(msglen) uint8_t* msg,
     uint32_t rem;
     ULONG i;
 
-#ifndef __REACTOS__
+#ifdef CRC32C_HW
     if (have_sse42) {
         return crc32c_hw(msg, msglen, seed);
     } else {
@@ -127,7 +162,7 @@ uint32_t calc_crc32c(_In_ uint32_t seed, _In_reads_bytes_(msglen) uint8_t* msg,
         for (i = 0; i < msglen; i++) {
             rem = crctable[(rem ^ msg[i]) & 0xff] ^ (rem >> 8);
         }
-#ifndef __REACTOS__
+#ifdef CRC32C_HW
     }
 #endif
 
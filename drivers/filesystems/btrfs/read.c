@@ -117,6 +117,9 @@ NTSTATUS check_csum(device_extension* Vcb, uint8_t* data, uint32_t sectors, uint
         return Status;
     }
 
+    // do some of the work ourselves while we're waiting
+    while (do_calc_job(Vcb, cj)) { }
+
     KeWaitForSingleObject(&cj->event, Executive, KernelMode, false, NULL);
 
     if (RtlCompareMemory(csum2, csum, sectors * sizeof(uint32_t)) != sectors * sizeof(uint32_t)) {
@@ -2712,6 +2715,41 @@ NTSTATUS read_stream(fcb* fcb, uint8_t* data, uint64_t start, ULONG length, ULON
     return STATUS_SUCCESS;
 }
 
+typedef struct {
+    calc_job* cj;
+    uint8_t* buf;
+    uint8_t* decomp;
+    uint8_t* dest;
+    ULONG off;
+    ULONG length;
+    LIST_ENTRY list_entry;
+} read_part;
+
+static NTSTATUS finish_read_part(device_extension* Vcb, read_part* rp) {
+    NTSTATUS Status;
+
+    // do the job ourselves if none of the calc threads have got to it yet
+    do_calc_job(Vcb, rp->cj);
+
+    KeWaitForSingleObject(&rp->cj->event, Executive, KernelMode, false, NULL);
+
+    Status = rp->cj->Status;
+
+    if (!NT_SUCCESS(Status))
+        ERR("decompression job returned %08x\n", Status);
+    else if (rp->decomp)
+        RtlCopyMemory(rp->dest, rp->decomp + rp->off, rp->length);
+
+    if (rp->decomp)
+        ExFreePool(rp->decomp);
+
+    ExFreePool(rp->buf);
+    free_calc_job(rp->cj);
+    ExFreePool(rp);
+
+    return Status;
+}
+
 NTSTATUS read_file(fcb* fcb, uint8_t* data, uint64_t start, uint64_t length, ULONG* pbr, PIRP Irp) {
     NTSTATUS Status;
     EXTENT_DATA* ed;
@@ -2719,9 +2757,14 @@ NTSTATUS read_file(fcb* fcb, uint8_t* data, uint64_t start, uint64_t length, ULO
     uint64_t last_end;
     LIST_ENTRY* le;
     POOL_TYPE pool_type;
+    LIST_ENTRY read_parts;
+    ULONG num_read_parts = 0;
+    bool user_buffer = (ULONG_PTR)data <= (ULONG_PTR)MmHighestUserAddress;
 
     TRACE("(%p, %p, %I64x, %I64x, %p)\n", fcb, data, start, length, pbr);
 
+    InitializeListHead(&read_parts);
+
     if (pbr)
         *pbr = 0;
 
@@ -2871,6 +2914,7 @@ NTSTATUS read_file(fcb* fcb, uint8_t* data, uint64_t start, uint64_t length, ULO
                     uint32_t bumpoff = 0, *csum;
                     uint64_t addr;
                     chunk* c;
+                    read_part* rp;
 
                     read = (uint32_t)(len - off);
                     if (read > length) read = (uint32_t)length;
@@ -2977,36 +3021,58 @@ NTSTATUS read_file(fcb* fcb, uint8_t* data, uint64_t start, uint64_t length, ULO
                             inpageoff = inoff % LZO_PAGE_SIZE;
                         }
 
-                        if (off2 != 0) {
-                            outlen = off2 + min(read, (uint32_t)(ed2->num_bytes - off));
+                        if (ed->compression != BTRFS_COMPRESSION_ZLIB && ed->compression != BTRFS_COMPRESSION_LZO &&
+                            ed->compression != BTRFS_COMPRESSION_ZSTD) {
+                            ERR("unsupported compression type %x\n", ed->compression);
+                            Status = STATUS_NOT_SUPPORTED;
+
+                            ExFreePool(buf);
 
-                            decomp = ExAllocatePoolWithTag(pool_type, outlen, ALLOC_TAG);
-                            if (!decomp) {
-                                ERR("out of memory\n");
-                                ExFreePool(buf);
-                                Status = STATUS_INSUFFICIENT_RESOURCES;
-                                goto exit;
-                            }
-                        } else
+                            goto exit;
+                        }
+
+                        // The calc threads can't write to a user-mode buffer, so if we'd be
+                        // decompressing straight into one, do it here as we used to.
+                        if (off2 == 0 && user_buffer) {
                             outlen = min(read, (uint32_t)(ed2->num_bytes - off));
 
-                        if (ed->compression == BTRFS_COMPRESSION_ZLIB) {
-                            Status = zlib_decompress(buf2, inlen, decomp ? decomp : (data + bytes_read), outlen);
+                            if (ed->compression == BTRFS_COMPRESSION_ZLIB) {
+                                Status = zlib_decompress(buf2, inlen, data + bytes_read, outlen);
+                                if (!NT_SUCCESS(Status))
+                                    ERR("zlib_decompress returned %08x\n", Status);
+                            } else if (ed->compression == BTRFS_COMPRESSION_LZO) {
+                                Status = lzo_decompress(buf2, inlen, data + bytes_read, outlen, inpageoff);
+                                if (!NT_SUCCESS(Status))
+                                    ERR("lzo_decompress returned %08x\n", Status);
+                            } else {
+                                Status = zstd_decompress(buf2, inlen, data + bytes_read, outlen);
+                                if (!NT_SUCCESS(Status))
+                                    ERR("zstd_decompress returned %08x\n", Status);
+                            }
 
                             if (!NT_SUCCESS(Status)) {
-                                ERR("zlib_decompress returned %08x\n", Status);
                                 ExFreePool(buf);
-
-                                if (decomp)
-                                    ExFreePool(decomp);
-
                                 goto exit;
                             }
-                        } else if (ed->compression == BTRFS_COMPRESSION_LZO) {
-                            Status = lzo_decompress(buf2, inlen, decomp ? decomp : (data + bytes_read), outlen, inpageoff);
+                        } else {
+                            if (off2 != 0) {
+                                outlen = off2 + min(read, (uint32_t)(ed2->num_bytes - off));
+
+                                decomp = ExAllocatePoolWithTag(pool_type, outlen, ALLOC_TAG);
+                                if (!decomp) {
+                                    ERR("out of memory\n");
+                                    ExFreePool(buf);
+                                    Status = STATUS_INSUFFICIENT_RESOURCES;
+                                    goto exit;
+                                }
+                            } else
+                                outlen = min(read, (uint32_t)(ed2->num_bytes - off));
+
+                            rp = ExAllocatePoolWithTag(pool_type, sizeof(read_part), ALLOC_TAG);
+                            if (!rp) {
+                                ERR("out of memory\n");
+                                Status = STATUS_INSUFFICIENT_RESOURCES;
 
-                            if (!NT_SUCCESS(Status)) {
-                                ERR("lzo_decompress returned %08x\n", Status);
                                 ExFreePool(buf);
 
                                 if (decomp)
@@ -3014,11 +3080,16 @@ NTSTATUS read_file(fcb* fcb, uint8_t* data, uint64_t start, uint64_t length, ULO
 
                                 goto exit;
                             }
-                        } else if (ed->compression == BTRFS_COMPRESSION_ZSTD) {
-                            Status = zstd_decompress(buf2, inlen, decomp ? decomp : (data + bytes_read), outlen);
 
+                            // Decompression is done by the calc threads, so that the extents of
+                            // a large read get decompressed in parallel.
+
+                            Status = add_calc_job_decomp(fcb->Vcb, ed->compression, buf2, inlen, decomp ? decomp : (data + bytes_read), outlen,
+                                                         inpageoff, &rp->cj);
                             if (!NT_SUCCESS(Status)) {
-                                ERR("zstd_decompress returned %08x\n", Status);
+                                ERR("add_calc_job_decomp returned %08x\n", Status);
+
+                                ExFreePool(rp);
                                 ExFreePool(buf);
 
                                 if (decomp)
@@ -3026,21 +3097,36 @@ NTSTATUS read_file(fcb* fcb, uint8_t* data, uint64_t start, uint64_t length, ULO
 
                                 goto exit;
                             }
-                        } else {
-                            ERR("unsupported compression type %x\n", ed->compression);
-                            Status = STATUS_NOT_SUPPORTED;
 
-                            ExFreePool(buf);
+                            rp->buf = buf;
+                            rp->decomp = decomp;
+                            rp->dest = data + bytes_read;
+                            rp->off = off2;
+                            rp->length = (ULONG)min(read, ed2->num_bytes - off);
 
-                            if (decomp)
-                                ExFreePool(decomp);
+                            InsertTailList(&read_parts, &rp->list_entry);
+                            num_read_parts++;
 
-                            goto exit;
-                        }
+                            // freed once the job has finished
+                            buf_free = false;
 
-                        if (decomp) {
-                            RtlCopyMemory(data + bytes_read, decomp + off2, (size_t)min(read, ed2->num_bytes - off));
-                            ExFreePool(decomp);
+                            // Collect the parts that have already finished, and wait for the oldest
+                            // one if we've queued enough to keep the calc threads busy, so that a large
+                            // read doesn't keep every compressed extent in memory until the end.
+                            while (!IsListEmpty(&read_parts)) {
+                                rp = CONTAINING_RECORD(read_parts.Flink, read_part, list_entry);
+
+                                if (num_read_parts < fcb->Vcb->calcthreads.num_threads * COMP_PARTS_PER_THREAD &&
+                                    !KeReadStateEvent(&rp->cj->event))
+                                    break;
+
+                                RemoveEntryList(&rp->list_entry);
+                                num_read_parts--;
+
+                                Status = finish_read_part(fcb->Vcb, rp);
+                                if (!NT_SUCCESS(Status))
+                                    goto exit;
+                            }
                         }
                     }
 
@@ -3093,11 +3179,26 @@ nextitem:
         length -= read;
     }
 
+    while (!IsListEmpty(&read_parts)) {
+        read_part* rp = CONTAINING_RECORD(RemoveHeadList(&read_parts), read_part, list_entry);
+
+        Status = finish_read_part(fcb->Vcb, rp);
+        if (!NT_SUCCESS(Status))
+            goto exit;
+    }
+
     Status = STATUS_SUCCESS;
     if (pbr)
         *pbr = bytes_read;
 
 exit:
+    // wait for anything still queued, as the jobs point into our buffers
+    while (!IsListEmpty(&read_parts)) {
+        read_part* rp = CONTAINING_RECORD(RemoveHeadList(&read_parts), read_part, list_entry);
+
+        finish_read_part(fcb->Vcb, rp);
+    }
+
     return Status;
 }
 
@@ -2803,6 +2803,9 @@ NTSTATUS calc_csum(_In_ device_extension* Vcb, _In_reads_bytes_(sectors*Vcb->sup
         return Status;
     }
 
+    // do some of the work ourselves while we're waiting
+    while (do_calc_job(Vcb, cj)) { }
+
     KeWaitForSingleObject(&cj->event, Executive, KernelMode, false, NULL);
     free_calc_job(cj);
 
@@ -4100,22 +4103,101 @@ nextitem:
     return STATUS_SUCCESS;
 }
 
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint8_t* buf;
+    calc_job* cj;
+} comp_part;
+
+static NTSTATUS queue_comp_part(fcb* fcb, uint8_t type, uint64_t start_data, uint64_t end_data, void* data, uint64_t i, comp_part* part) {
+    NTSTATUS Status;
+    uint32_t inlen;
+
+    part->start = start_data + (i * COMPRESSED_EXTENT_SIZE);
+    part->end = min(part->start + COMPRESSED_EXTENT_SIZE, end_data);
+
+    inlen = (uint32_t)(part->end - part->start);
+
+    Status = add_calc_job_comp(fcb->Vcb, type, (uint8_t*)data + (i * COMPRESSED_EXTENT_SIZE), inlen, part->buf,
+                               compress_buffer_size(type, inlen), &part->cj);
+    if (!NT_SUCCESS(Status)) {
+        ERR("add_calc_job_comp returned %08x\n", Status);
+        part->cj = NULL;
+    }
+
+    return Status;
+}
+
 NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, PIRP Irp, LIST_ENTRY* rollback) {
     NTSTATUS Status;
     uint64_t i;
+    unsigned int num_parts = (unsigned int)(sector_align(end_data - start_data, COMPRESSED_EXTENT_SIZE) / COMPRESSED_EXTENT_SIZE);
+    unsigned int window, slot;
+    uint8_t type;
+    comp_part* parts;
+    uint32_t buflen;
+    uint8_t* buf;
+
+    type = get_compression_type(fcb);
+
+    // Only a few parts are in flight at a time, and their buffers get reused as they're written,
+    // so a large write doesn't need output buffers for all of it at once
+
+    window = min(num_parts, fcb->Vcb->calcthreads.num_threads * COMP_PARTS_PER_THREAD);
+    buflen = compress_buffer_size(type, COMPRESSED_EXTENT_SIZE);
+
+    parts = ExAllocatePoolWithTag(PagedPool, sizeof(comp_part) * window, ALLOC_TAG);
+    if (!parts) {
+        ERR("out of memory\n");
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    buf = ExAllocatePoolWithTag(PagedPool, buflen * window, ALLOC_TAG);
+    if (!buf) {
+        ERR("out of memory\n");
+        ExFreePool(parts);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (slot = 0; slot < window; slot++) {
+        parts[slot].buf = buf + (slot * buflen);
+        parts[slot].cj = NULL;
+    }
+
+    Status = STATUS_SUCCESS;
+
+    for (i = 0; i < window; i++) {
+        Status = queue_comp_part(fcb, type, start_data, end_data, data, i, &parts[i]);
+        if (!NT_SUCCESS(Status))
+            break;
+    }
 
-    for (i = 0; i < sector_align(end_data - start_data, COMPRESSED_EXTENT_SIZE) / COMPRESSED_EXTENT_SIZE; i++) {
-        uint64_t s2, e2;
+    // Extents have to be allocated and written in order. Once a part has been written, its slot
+    // is used for the part a whole window further on.
+
+    for (i = 0; NT_SUCCESS(Status) && i < num_parts; i++) {
+        comp_part* part = &parts[i % window];
         bool compressed;
+        uint64_t s2 = part->start, e2 = part->end;
+
+        // Help out rather than just waiting, in case no calc thread has got round to it yet
+        do_calc_job(fcb->Vcb, part->cj);
 
-        s2 = start_data + (i * COMPRESSED_EXTENT_SIZE);
-        e2 = min(s2 + COMPRESSED_EXTENT_SIZE, end_data);
+        KeWaitForSingleObject(&part->cj->event, Executive, KernelMode, false, NULL);
 
-        Status = write_compressed_bit(fcb, s2, e2, (uint8_t*)data + (i * COMPRESSED_EXTENT_SIZE), &compressed, Irp, rollback);
+        if (!NT_SUCCESS(part->cj->Status)) {
+            ERR("compression job returned %08x\n", part->cj->Status);
+            Status = part->cj->Status;
+            break;
+        }
+
+        Status = write_compressed_bit(fcb, s2, e2, (uint8_t*)data + (i * COMPRESSED_EXTENT_SIZE), type, part->buf,
+                                      part->cj->space_left, &compressed, Irp, rollback);
 
         if (!NT_SUCCESS(Status)) {
             ERR("write_compressed_bit returned %08x\n", Status);
-            return Status;
+            break;
         }
 
         // If the first 128 KB of a file is incompressible, we set the nocompress flag so we don't
@@ -4129,17 +4211,33 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
             if (e2 < end_data) {
                 Status = do_write_file(fcb, e2, end_data, (uint8_t*)data + e2, Irp, false, 0, rollback);
 
-                if (!NT_SUCCESS(Status)) {
+                if (!NT_SUCCESS(Status))
                     ERR("do_write_file returned %08x\n", Status);
-                    return Status;
-                }
             }
 
-            return STATUS_SUCCESS;
+            break;
+        }
+
+        free_calc_job(part->cj);
+        part->cj = NULL;
+
+        if (i + window < num_parts)
+            Status = queue_comp_part(fcb, type, start_data, end_data, data, i + window, part);
+    }
+
+    // The calc threads may still be using the buffers of parts we didn't get to
+
+    for (slot = 0; slot < window; slot++) {
+        if (parts[slot].cj) {
+            KeWaitForSingleObject(&parts[slot].cj->event, Executive, KernelMode, false, NULL);
+            free_calc_job(parts[slot].cj);
         }
     }
 
-    return STATUS_SUCCESS;
+    ExFreePool(buf);
+    ExFreePool(parts);
+
+    return Status;
 }
 
 NTSTATUS write_file2(device_extension* Vcb, PIRP Irp, LARGE_INTEGER offset, void* buf, ULONG* length, bool paging_io, bool no_cache,
@@ -86,6 +86,12 @@ typedef IO_STACK_LOCATION EXTENDED_IO_STACK_LOCATION, *PEXTENDED_IO_STACK_LOCATI
 #define SUPER_BLOCK_SIZE                (0x400)
 
 #define READ_AHEAD_GRANULARITY          (0x10000)
+#define SEQ_READ_AHEAD_GRANULARITY      (0x40000)
+
+/* larger read-ahead for streams opened for sequential access */
+#define Ext2ReadAheadGranularity(FileObject)                    \
+    (IsFlagOn((FileObject)->Flags, FO_SEQUENTIAL_ONLY) ?         \
+     SEQ_READ_AHEAD_GRANULARITY : READ_AHEAD_GRANULARITY)
 
 #define SUPER_BLOCK                     (Vcb->SuperBlock)
 
@@ -1666,6 +1672,14 @@ Ext2MapExtent(
     OUT PULONG              Number
     );
 
+NTSTATUS
+Ext2LoadExtentZone(
+    IN PEXT2_IRP_CONTEXT    IrpContext,
+    IN PEXT2_VCB            Vcb,
+    IN PEXT2_MCB            Mcb,
+    IN ULONG                End
+    );
+
 NTSTATUS
 Ext2ExpandExtent(
     PEXT2_IRP_CONTEXT IrpContext,
@@ -251,6 +251,11 @@ static inline uint64_t idx_to_block(EXT4_EXTENT_IDX *idx)
 int ext4_ext_get_blocks(void *icb, handle_t *handle, struct inode *inode, ext4_fsblk_t iblock,
 			unsigned long max_blocks, struct buffer_head *bh_result,
 			int create, int flags);
+typedef int (*ext4_ext_walk_fn)(struct inode *inode, ext4_lblk_t lblk,
+				ext4_fsblk_t pblk, unsigned short len,
+				int unwritten, void *data);
+int ext4_ext_walk_blocks(struct inode *inode, ext4_lblk_t start,
+			ext4_lblk_t end, ext4_ext_walk_fn fn, void *data);
 int ext4_ext_tree_init(void *icb, handle_t *handle, struct inode *inode);
 int ext4_ext_truncate(void *icb, struct inode *inode, unsigned long start);
 
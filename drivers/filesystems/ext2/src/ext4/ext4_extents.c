@@ -2439,7 +2439,19 @@ int ext4_ext_get_blocks(void *icb, handle_t *handle, struct inode *inode, ext4_f
 	 * we couldn't try to create block if create flag is zero
 	 */
 	if (!create) {
-		goto out2;
+		/*
+		 * report the hole up to the next allocated extent, so that
+		 * a sparse range is not probed one block at a time
+		 */
+		if (ex && le32_to_cpu(ex->ee_block) > iblock)
+			next = le32_to_cpu(ex->ee_block);
+		else
+			next = ext4_ext_next_allocated_block(path);
+		if (next <= iblock)
+			goto out2;
+		allocated = next - iblock;
+		newblock = 0;
+		goto out;
 	}
 
 	/* find next allocated block so that we know how many
@@ -2506,6 +2518,65 @@ out2:
 	return err ? err : allocated;
 }
 
+/*
+ * ext4_ext_walk_blocks:
+ * calls @fn for every extent overlapping [@start, @end), descending
+ * the tree once per leaf instead of once per extent. the walk stops
+ * at the first non-zero value returned by @fn.
+ */
+int ext4_ext_walk_blocks(struct inode *inode, ext4_lblk_t start,
+		ext4_lblk_t end, ext4_ext_walk_fn fn, void *data)
+{
+	struct ext4_ext_path *path = NULL;
+	struct ext4_extent *ex;
+	ext4_lblk_t block = start, next;
+	int depth, err = 0;
+
+	while (block < end) {
+		path = ext4_find_extent(inode, block, &path, 0);
+		if (IS_ERR(path)) {
+			err = PTR_ERR(path);
+			path = NULL;
+			break;
+		}
+
+		depth = ext_depth(inode);
+		ex = path[depth].p_ext;
+		if (!ex)
+			break;
+
+		for (; ex <= EXT_LAST_EXTENT(path[depth].p_hdr); ex++) {
+			ext4_lblk_t ee_block = le32_to_cpu(ex->ee_block);
+			unsigned short ee_len = ext4_ext_get_actual_len(ex);
+
+			if (ee_block >= end)
+				goto out;
+			if (ee_block + ee_len <= block)
+				continue;
+			err = fn(inode, ee_block, ext4_ext_pblock(ex), ee_len,
+					ext4_ext_is_unwritten(ex), data);
+			if (err)
+				goto out;
+		}
+
+		next = ext4_ext_next_leaf_block(path);
+		if (next <= block) {
+			/* index entries must be increasing */
+			if (next != EXT_MAX_BLOCKS)
+				err = -EIO;
+			break;
+		}
+		block = next;
+	}
+
+out:
+	if (path) {
+		ext4_ext_drop_refs(path);
+		kfree(path);
+	}
+	return err;
+}
+
 int ext4_ext_truncate(void *icb, struct inode *inode, unsigned long start)
 {
     int ret = ext4_ext_remove_space(icb, inode, start);
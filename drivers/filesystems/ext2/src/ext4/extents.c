@@ -101,6 +101,67 @@ Ext2MapExtent(
 }
 
 
+static int
+Ext2AddZoneExtent(
+    struct inode *inode,
+    ext4_lblk_t   lblk,
+    ext4_fsblk_t  pblk,
+    unsigned short len,
+    int           unwritten,
+    void         *data
+)
+{
+    PEXT2_MCB   Mcb = (PEXT2_MCB)data;
+    PEXT2_VCB   Vcb = inode->i_sb->s_priv;
+
+    /* unwritten extents read as zero, keep them as holes */
+    if (unwritten || pblk == 0) {
+        return 0;
+    }
+
+    /* skip wrong blocks, as Ext2InitializeZone does */
+    if (pblk + len > TOTAL_BLOCKS) {
+        return 0;
+    }
+
+    if (!Ext2AddBlockExtent(Vcb, Mcb, lblk, (ULONG)pblk, len)) {
+        DbgBreak();
+        return -ENOMEM;
+    }
+
+    DEBUG(DL_MAP, ("Ext2LoadExtentZone %wZ: Block = %xh Mapped = %xh\n",
+                   &Mcb->FullName, (ULONG)pblk, len));
+    return 0;
+}
+
+NTSTATUS
+Ext2LoadExtentZone(
+    IN PEXT2_IRP_CONTEXT    IrpContext,
+    IN PEXT2_VCB            Vcb,
+    IN PEXT2_MCB            Mcb,
+    IN ULONG                End
+)
+{
+    EXT4_EXTENT_HEADER *eh;
+    int    rc;
+
+    eh = get_ext4_header(&Mcb->Inode);
+    if (eh->eh_magic != EXT4_EXT_MAGIC) {
+        /* extent tree not initialized yet: the whole file is a hole */
+        return STATUS_SUCCESS;
+    }
+
+    /* one descent per leaf block, not per extent */
+    rc = ext4_ext_walk_blocks(&Mcb->Inode, 0, End, Ext2AddZoneExtent, Mcb);
+    if (rc < 0) {
+        DEBUG(DL_ERR, ("Ext2LoadExtentZone: failed to walk extents, err: %d\n", rc));
+        return Ext2WinntError(rc);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
 NTSTATUS
 Ext2DoExtentExpand(
     IN PEXT2_IRP_CONTEXT    IrpContext,
@@ -1137,32 +1137,29 @@ Ext2InitializeZone(
     ASSERT(Mcb != NULL);
     End = (ULONG)((Mcb->Inode.i_size + BLOCK_SIZE - 1) >> BLOCK_BITS);
 
+    /* extent-mapped files: load all the leaves in a single tree walk */
+    if (INODE_HAS_EXTENT(&Mcb->Inode)) {
+        Status = Ext2LoadExtentZone(IrpContext, Vcb, Mcb, End);
+        if (!NT_SUCCESS(Status)) {
+            goto errorout;
+        }
+        Start = End;
+    }
+
     while (Start < End) {
 
         Block = Mapped = 0;
 
         /* mapping file offset to ext2 block */
-        if (INODE_HAS_EXTENT(&Mcb->Inode)) {
-            Status = Ext2MapExtent(
-                         IrpContext,
-                         Vcb,
-                         Mcb,
-                         Start,
-                         FALSE,
-                         &Block,
-                         &Mapped
-                     );
-        } else {
-            Status = Ext2MapIndirect(
-                         IrpContext,
-                         Vcb,
-                         Mcb,
-                         Start,
-                         FALSE,
-                         &Block,
-                         &Mapped
-                     );
-        }
+        Status = Ext2MapIndirect(
+                     IrpContext,
+                     Vcb,
+                     Mcb,
+                     Start,
+                     FALSE,
+                     &Block,
+                     &Mapped
+                 );
 
         if (!NT_SUCCESS(Status)) {
             goto errorout;
@@ -1261,8 +1258,9 @@ Ext2BuildExtents(
                      &Mapped);
 
             if (!rc) {
-                /* we likely get a sparse file here */
-                Mapped = 1;
+                /* we likely get a sparse file here: the zone covers the
+                   whole file, so it's a hole up to the end of the range */
+                Mapped = bAlloc ? 1 : End - Start;
                 Block = 0;
             }
         }
@@ -1316,7 +1314,8 @@ Ext2BuildExtents(
 
         if (Block != 0) {
 
-            if (List && List->Lba + List->Length == Lba) {
+            if (List && List->Lba + List->Length == Lba &&
+                List->Offset + List->Length == Total) {
 
                 /* it's continuous upon previous Extent */
                 List->Length += Length;
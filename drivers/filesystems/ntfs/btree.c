@@ -468,6 +468,160 @@ CompareTreeKeys(PB_TREE_KEY Key1, PB_TREE_KEY Key2, BOOLEAN CaseSensitive)
     return Comparison;
 }
 
+/**
+* @name CompareIndexEntryName
+* @implemented
+*
+* Compares a file name against the key of an index entry, using the same collation as CompareTreeKeys().
+*
+* @param FileName
+* Pointer to a UNICODE_STRING with the name being looked up.
+*
+* @param IndexEntry
+* Pointer to the INDEX_ENTRY_ATTRIBUTE being compared. Must not be the final (dummy) entry of a node.
+*
+* @param CaseSensitive
+* Boolean indicating if the function should operate in case-sensitive mode.
+*
+* @returns
+* 0 if the names are equal.
+* < 0 if FileName sorts before the name of IndexEntry.
+* > 0 if FileName sorts after the name of IndexEntry.
+*/
+LONG
+CompareIndexEntryName(PUNICODE_STRING FileName,
+                      PINDEX_ENTRY_ATTRIBUTE IndexEntry,
+                      BOOLEAN CaseSensitive)
+{
+    UNICODE_STRING EntryName;
+
+    ASSERT(!(IndexEntry->Flags & NTFS_INDEX_ENTRY_END));
+
+    EntryName.Buffer = IndexEntry->FileName.Name;
+    EntryName.Length = EntryName.MaximumLength
+        = IndexEntry->FileName.NameLength * sizeof(WCHAR);
+
+    // RtlCompareUnicodeString() sorts a prefix before the longer name, just like CompareTreeKeys()
+    return RtlCompareUnicodeString(FileName, &EntryName, !CaseSensitive);
+}
+
+/**
+* @name SearchIndexNode
+* @implemented
+*
+* Performs a binary search for a file name among the entries of a single index node (index root or index buffer).
+*
+* @param FirstEntry
+* Pointer to the first INDEX_ENTRY_ATTRIBUTE of the node.
+*
+* @param LastEntry
+* Pointer just past the last byte of the node's entries. Used for bounds checking.
+*
+* @param FileName
+* Pointer to a UNICODE_STRING with the name being looked up.
+*
+* @param FoundEntry
+* Pointer to a PINDEX_ENTRY_ATTRIBUTE that will receive either the entry whose name matches FileName,
+* or the first entry that sorts after FileName (possibly the final dummy entry). In the latter case,
+* if that entry has a sub-node, it's the sub-node that may contain FileName.
+*
+* @param ExactMatch
+* Pointer to a BOOLEAN that will be set to TRUE if FoundEntry matches FileName.
+*
+* @return
+* STATUS_SUCCESS on success.
+* STATUS_INSUFFICIENT_RESOURCES if an allocation failed.
+* STATUS_DATA_ERROR if the node isn't terminated by an end entry within its bounds.
+*
+* @remarks
+* The comparison is always case-insensitive, because that's the collation NTFS uses for $I30 indices.
+* Callers that need case-sensitive semantics must check the name of FoundEntry themselves.
+*/
+NTSTATUS
+SearchIndexNode(PINDEX_ENTRY_ATTRIBUTE FirstEntry,
+                PINDEX_ENTRY_ATTRIBUTE LastEntry,
+                PUNICODE_STRING FileName,
+                PINDEX_ENTRY_ATTRIBUTE *FoundEntry,
+                PBOOLEAN ExactMatch)
+{
+    PINDEX_ENTRY_ATTRIBUTE LocalEntries[NTFS_INDEX_SEARCH_STACK_ENTRIES];
+    PINDEX_ENTRY_ATTRIBUTE *Entries = LocalEntries;
+    PINDEX_ENTRY_ATTRIBUTE CurrentEntry;
+    ULONG EntryCount = 0;
+    ULONG Low, High, Middle;
+    LONG Comparison;
+
+    // Count the entries of the node, excluding the final dummy entry
+    CurrentEntry = FirstEntry;
+    while (TRUE)
+    {
+        if (CurrentEntry >= LastEntry ||
+            CurrentEntry->Length < FIELD_OFFSET(INDEX_ENTRY_ATTRIBUTE, FileName))
+        {
+            DPRINT1("Filesystem corruption detected!\n");
+            return STATUS_DATA_ERROR;
+        }
+
+        if (CurrentEntry->Flags & NTFS_INDEX_ENTRY_END)
+            break;
+
+        EntryCount++;
+        CurrentEntry = (PINDEX_ENTRY_ATTRIBUTE)((ULONG_PTR)CurrentEntry + CurrentEntry->Length);
+    }
+
+    // Large index buffers may hold more entries than we keep on the stack
+    if (EntryCount > NTFS_INDEX_SEARCH_STACK_ENTRIES)
+    {
+        Entries = ExAllocatePoolWithTag(NonPagedPool, EntryCount * sizeof(PINDEX_ENTRY_ATTRIBUTE), TAG_NTFS);
+        if (!Entries)
+        {
+            DPRINT1("ERROR: Couldn't allocate memory for index entries!\n");
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    // Gather the entries so they can be accessed by position
+    CurrentEntry = FirstEntry;
+    for (Middle = 0; Middle < EntryCount; Middle++)
+    {
+        Entries[Middle] = CurrentEntry;
+        CurrentEntry = (PINDEX_ENTRY_ATTRIBUTE)((ULONG_PTR)CurrentEntry + CurrentEntry->Length);
+    }
+
+    // CurrentEntry is now the dummy entry, which sorts after every name
+    *FoundEntry = CurrentEntry;
+    *ExactMatch = FALSE;
+
+    // Find the first entry that doesn't sort before FileName
+    Low = 0;
+    High = EntryCount;
+    while (Low < High)
+    {
+        Middle = Low + (High - Low) / 2;
+
+        Comparison = CompareIndexEntryName(FileName, Entries[Middle], FALSE);
+        if (Comparison == 0)
+        {
+            *FoundEntry = Entries[Middle];
+            *ExactMatch = TRUE;
+            break;
+        }
+
+        if (Comparison < 0)
+            High = Middle;
+        else
+            Low = Middle + 1;
+    }
+
+    if (!*ExactMatch && Low < EntryCount)
+        *FoundEntry = Entries[Low];
+
+    if (Entries != LocalEntries)
+        ExFreePoolWithTag(Entries, TAG_NTFS);
+
+    return STATUS_SUCCESS;
+}
+
 /**
 * @name CountBTreeKeys
 * @implemented
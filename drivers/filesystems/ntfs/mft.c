@@ -3142,6 +3142,187 @@ BrowseIndexEntries(PDEVICE_EXTENSION Vcb,
     return STATUS_OBJECT_PATH_NOT_FOUND;
 }
 
+/**
+* @name NtfsLookupIndexEntry
+* @implemented
+*
+* Looks up a file name in a $I30 index by descending the B+tree, instead of browsing every index entry.
+*
+* @param Vcb
+* Pointer to the DEVICE_EXTENSION of the volume.
+*
+* @param MftRecord
+* Pointer to the file record of the directory whose index is searched.
+*
+* @param IndexRoot
+* Pointer to a copy of the $I30 INDEX_ROOT_ATTRIBUTE of the directory.
+*
+* @param FileName
+* Pointer to a UNICODE_STRING with the name being looked up. Wildcards aren't supported.
+*
+* @param CaseSensitive
+* Boolean indicating if the lookup should be case-sensitive.
+*
+* @param OutMFTIndex
+* Pointer to a ULONGLONG that will receive the MFT index of the file, on success.
+*
+* @return
+* STATUS_SUCCESS if the file was found.
+* STATUS_OBJECT_PATH_NOT_FOUND if the index doesn't contain the file.
+* STATUS_MORE_PROCESSING_REQUIRED if only a case-insensitive match was found during a case-sensitive
+* lookup, or if the matching entry is a DOS name or a system file; the caller must then browse the index
+* with BrowseIndexEntries().
+* Another error status if the index couldn't be read or is corrupted.
+*
+* @remarks
+* Every node is searched with SearchIndexNode(), and only the index buffers on the path from the root to the
+* matching entry are read, so the lookup is logarithmic in the number of entries of the directory.
+*/
+static
+NTSTATUS
+NtfsLookupIndexEntry(PDEVICE_EXTENSION Vcb,
+                     PFILE_RECORD_HEADER MftRecord,
+                     PINDEX_ROOT_ATTRIBUTE IndexRoot,
+                     PUNICODE_STRING FileName,
+                     BOOLEAN CaseSensitive,
+                     ULONGLONG *OutMFTIndex)
+{
+    PNTFS_ATTR_CONTEXT IndexAllocationContext = NULL;
+    PINDEX_BUFFER IndexBuffer = NULL;
+    PINDEX_ENTRY_ATTRIBUTE FirstEntry;
+    PINDEX_ENTRY_ATTRIBUTE LastEntry;
+    PINDEX_ENTRY_ATTRIBUTE IndexEntry;
+    BOOLEAN ExactMatch;
+    BOOLEAN LargeIndex;
+    ULONG IndexBlockSize = IndexRoot->SizeOfEntry;
+    ULONGLONG VCN;
+    ULONG BytesRead;
+    NTSTATUS Status;
+
+    DPRINT("NtfsLookupIndexEntry(%p, %p, %p, %wZ, %s, %p)\n",
+           Vcb,
+           MftRecord,
+           IndexRoot,
+           FileName,
+           CaseSensitive ? "TRUE" : "FALSE",
+           OutMFTIndex);
+
+    // Start with the entries of the index root
+    FirstEntry = (PINDEX_ENTRY_ATTRIBUTE)((ULONG_PTR)&IndexRoot->Header + IndexRoot->Header.FirstEntryOffset);
+    LastEntry = (PINDEX_ENTRY_ATTRIBUTE)((ULONG_PTR)&IndexRoot->Header + IndexRoot->Header.TotalSizeOfEntries);
+    LargeIndex = (IndexRoot->Header.Flags & INDEX_ROOT_LARGE) != 0;
+
+    while (TRUE)
+    {
+        Status = SearchIndexNode(FirstEntry, LastEntry, FileName, &IndexEntry, &ExactMatch);
+        if (!NT_SUCCESS(Status))
+            break;
+
+        if (ExactMatch)
+        {
+            if (CaseSensitive && CompareIndexEntryName(FileName, IndexEntry, TRUE) != 0)
+            {
+                // Names differing only by case may be spread over several nodes
+                Status = STATUS_MORE_PROCESSING_REQUIRED;
+            }
+            else if ((IndexEntry->Data.Directory.IndexedFile & NTFS_MFT_MASK) < NTFS_FILE_FIRST_USER_FILE ||
+                     IndexEntry->FileName.NameType == NTFS_FILE_NAME_DOS)
+            {
+                // BrowseIndexEntries() skips this entry, but another entry
+                // matching the name may sit next to it in another node
+                Status = STATUS_MORE_PROCESSING_REQUIRED;
+            }
+            else
+            {
+                *OutMFTIndex = (IndexEntry->Data.Directory.IndexedFile & NTFS_MFT_MASK);
+                Status = STATUS_SUCCESS;
+            }
+            break;
+        }
+
+        // If FileName exists, it must be in the sub-node of the first entry sorting after it
+        if (!(IndexEntry->Flags & NTFS_INDEX_ENTRY_NODE))
+        {
+            Status = STATUS_OBJECT_PATH_NOT_FOUND;
+            break;
+        }
+
+        if (!LargeIndex)
+        {
+            DPRINT1("Filesystem corruption detected!\n");
+            Status = STATUS_DATA_ERROR;
+            break;
+        }
+
+        // Get the VCN before the entry gets overwritten by the next index buffer
+        VCN = GetIndexEntryVCN(IndexEntry);
+
+        if (!IndexAllocationContext)
+        {
+            Status = FindAttribute(Vcb, MftRecord, AttributeIndexAllocation, L"$I30", 4, &IndexAllocationContext, NULL);
+            if (!NT_SUCCESS(Status))
+            {
+                DPRINT1("Filesystem corruption detected!\n");
+                IndexAllocationContext = NULL;
+                break;
+            }
+
+            IndexBuffer = ExAllocatePoolWithTag(NonPagedPool, IndexBlockSize, TAG_NTFS);
+            if (!IndexBuffer)
+            {
+                DPRINT1("Unable to allocate memory for index record!\n");
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                break;
+            }
+        }
+
+        // Read the index buffer of the sub-node
+        BytesRead = ReadAttribute(Vcb,
+                                  IndexAllocationContext,
+                                  GetAllocationOffsetFromVCN(Vcb, IndexBlockSize, VCN),
+                                  (PCHAR)IndexBuffer,
+                                  IndexBlockSize);
+        if (BytesRead != IndexBlockSize)
+        {
+            DPRINT1("Unable to read index record!\n");
+            Status = STATUS_UNSUCCESSFUL;
+            break;
+        }
+
+        if (IndexBuffer->Ntfs.Type != NRH_INDX_TYPE)
+        {
+            DPRINT1("Filesystem corruption detected, node with VCN %I64u isn't an index record!\n", VCN);
+            Status = STATUS_DATA_ERROR;
+            break;
+        }
+
+        Status = FixupUpdateSequenceArray(Vcb, &((PFILE_RECORD_HEADER)IndexBuffer)->Ntfs);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Failed to apply fixup array!\n");
+            break;
+        }
+
+        if (IndexBuffer->Header.TotalSizeOfEntries + FIELD_OFFSET(INDEX_BUFFER, Header) > IndexBlockSize)
+        {
+            DPRINT1("Filesystem corruption detected!\n");
+            Status = STATUS_DATA_ERROR;
+            break;
+        }
+
+        FirstEntry = (PINDEX_ENTRY_ATTRIBUTE)((ULONG_PTR)&IndexBuffer->Header + IndexBuffer->Header.FirstEntryOffset);
+        LastEntry = (PINDEX_ENTRY_ATTRIBUTE)((ULONG_PTR)&IndexBuffer->Header + IndexBuffer->Header.TotalSizeOfEntries);
+        LargeIndex = (IndexBuffer->Header.Flags & INDEX_NODE_LARGE) != 0;
+    }
+
+    if (IndexBuffer)
+        ExFreePoolWithTag(IndexBuffer, TAG_NTFS);
+    if (IndexAllocationContext)
+        ReleaseAttributeContext(IndexAllocationContext);
+
+    return Status;
+}
+
 NTSTATUS
 NtfsFindMftRecord(PDEVICE_EXTENSION Vcb,
                   ULONGLONG MFTIndex,
@@ -3206,6 +3387,18 @@ NtfsFindMftRecord(PDEVICE_EXTENSION Vcb,
 
     DPRINT("IndexRecordSize: %x IndexBlockSize: %x\n", Vcb->NtfsInfo.BytesPerIndexRecord, IndexRoot->SizeOfEntry);
 
+    // Looking up a single name doesn't require walking the whole index
+    if (!DirSearch)
+    {
+        Status = NtfsLookupIndexEntry(Vcb, MftRecord, IndexRoot, FileName, CaseSensitive, OutMFTIndex);
+        if (Status != STATUS_MORE_PROCESSING_REQUIRED)
+        {
+            ExFreePoolWithTag(IndexRecord, TAG_NTFS);
+            ExFreeToNPagedLookasideList(&Vcb->FileRecLookasideList, MftRecord);
+            return Status;
+        }
+    }
+
     Status = BrowseIndexEntries(Vcb,
                                 MftRecord,
                                 (PINDEX_ROOT_ATTRIBUTE)IndexRecord,
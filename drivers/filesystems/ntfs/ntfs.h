@@ -214,6 +214,9 @@ typedef enum
 #define NTFS_INDEX_ENTRY_NODE            1
 #define NTFS_INDEX_ENTRY_END            2
 
+// Number of index entries SearchIndexNode() can handle without allocating memory
+#define NTFS_INDEX_SEARCH_STACK_ENTRIES 64
+
 #define NTFS_FILE_NAME_POSIX            0
 #define NTFS_FILE_NAME_WIN32            1
 #define NTFS_FILE_NAME_DOS            2
@@ -738,6 +741,11 @@ NtfsDeviceIoControl(IN PDEVICE_OBJECT DeviceObject,
 
 /* btree.c */
 
+LONG
+CompareIndexEntryName(PUNICODE_STRING FileName,
+                      PINDEX_ENTRY_ATTRIBUTE IndexEntry,
+                      BOOLEAN CaseSensitive);
+
 LONG
 CompareTreeKeys(PB_TREE_KEY Key1,
                 PB_TREE_KEY Key2,
@@ -807,6 +815,13 @@ NtfsInsertKey(PB_TREE Tree,
               PB_TREE_KEY *MedianKey,
               PB_TREE_FILENAME_NODE *NewRightHandSibling);
 
+NTSTATUS
+SearchIndexNode(PINDEX_ENTRY_ATTRIBUTE FirstEntry,
+                PINDEX_ENTRY_ATTRIBUTE LastEntry,
+                PUNICODE_STRING FileName,
+                PINDEX_ENTRY_ATTRIBUTE *FoundEntry,
+                PBOOLEAN ExactMatch);
+
 NTSTATUS
 SplitBTreeNode(PB_TREE Tree,
                PB_TREE_FILENAME_NODE Node,
@@ -381,17 +381,29 @@ AfdEnumEvents( PDEVICE_OBJECT DeviceObject, PIRP Irp,
 /* * * NOTE ALWAYS CALLED AT DISPATCH_LEVEL * * */
 static BOOLEAN UpdatePollWithFCB( PAFD_ACTIVE_POLL Poll, PFILE_OBJECT FileObject ) {
     UINT i;
-    PAFD_FCB FCB;
+    PAFD_FCB FCB = FileObject->FsContext;
     UINT Signalled = 0;
     PAFD_POLL_INFO PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+    PFILE_OBJECT HandleObject;
 
     ASSERT( KeGetCurrentIrql() == DISPATCH_LEVEL );
 
+    /* Every other socket in this poll was checked when its own state last
+     * changed, so only the one that changed now can make the poll ready.
+     * Leave the others alone unless it is ours and has an event we want. */
+    for( i = 0; i < PollReq->HandleCount; i++ ) {
+        if( (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle == FileObject &&
+            (PollReq->Handles[i].Events & FCB->PollState) )
+            break;
+    }
+
+    if( i == PollReq->HandleCount ) return FALSE;
+
     for( i = 0; i < PollReq->HandleCount; i++ ) {
         if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
 
-        FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
-        FCB = FileObject->FsContext;
+        HandleObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+        FCB = HandleObject->FsContext;
 
         PollReq->Handles[i].Status = PollReq->Handles[i].Events & FCB->PollState;
         if( PollReq->Handles[i].Status ) {
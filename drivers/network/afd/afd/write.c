@@ -10,6 +10,26 @@
 
 #include "afd.h"
 
+static VOID FailPendingSends( PAFD_FCB FCB, NTSTATUS Status ) {
+    PLIST_ENTRY NextIrpEntry;
+    PIRP NextIrp;
+    PIO_STACK_LOCATION NextIrpSp;
+    PAFD_SEND_INFO SendReq;
+
+    while( !IsListEmpty( &FCB->PendingIrpList[FUNCTION_SEND] ) ) {
+        NextIrpEntry = RemoveHeadList(&FCB->PendingIrpList[FUNCTION_SEND]);
+        NextIrp = CONTAINING_RECORD(NextIrpEntry, IRP, Tail.Overlay.ListEntry);
+        NextIrpSp = IoGetCurrentIrpStackLocation( NextIrp );
+        SendReq = GetLockedData(NextIrp, NextIrpSp);
+        NextIrp->IoStatus.Status = Status;
+        NextIrp->IoStatus.Information = 0;
+        UnlockBuffers(SendReq->BufferArray, SendReq->BufferCount, FALSE);
+        if( NextIrp->MdlAddress ) UnlockRequest( NextIrp, NextIrpSp );
+        (void)IoSetCancelRoutine(NextIrp, NULL);
+        IoCompleteRequest( NextIrp, IO_NETWORK_INCREMENT );
+    }
+}
+
 static IO_COMPLETION_ROUTINE SendComplete;
 static NTSTATUS NTAPI SendComplete
 ( PDEVICE_OBJECT DeviceObject,
@@ -50,18 +70,7 @@ static NTSTATUS NTAPI SendComplete
 
     if( FCB->State == SOCKET_STATE_CLOSED ) {
         /* Cleanup our IRP queue because the FCB is being destroyed */
-        while( !IsListEmpty( &FCB->PendingIrpList[FUNCTION_SEND] ) ) {
-            NextIrpEntry = RemoveHeadList(&FCB->PendingIrpList[FUNCTION_SEND]);
-            NextIrp = CONTAINING_RECORD(NextIrpEntry, IRP, Tail.Overlay.ListEntry);
-            NextIrpSp = IoGetCurrentIrpStackLocation( NextIrp );
-            SendReq = GetLockedData(NextIrp, NextIrpSp);
-            NextIrp->IoStatus.Status = STATUS_FILE_CLOSED;
-            NextIrp->IoStatus.Information = 0;
-            UnlockBuffers(SendReq->BufferArray, SendReq->BufferCount, FALSE);
-            if( NextIrp->MdlAddress ) UnlockRequest( NextIrp, IoGetCurrentIrpStackLocation( NextIrp ) );
-            (void)IoSetCancelRoutine(NextIrp, NULL);
-            IoCompleteRequest( NextIrp, IO_NETWORK_INCREMENT );
-        }
+        FailPendingSends(FCB, STATUS_FILE_CLOSED);
 
         RetryDisconnectCompletion(FCB);
 
@@ -71,26 +80,7 @@ static NTSTATUS NTAPI SendComplete
 
     if( !NT_SUCCESS(Status) ) {
         /* Complete all following send IRPs with error */
-
-        while( !IsListEmpty( &FCB->PendingIrpList[FUNCTION_SEND] ) ) {
-            NextIrpEntry =
-                RemoveHeadList(&FCB->PendingIrpList[FUNCTION_SEND]);
-            NextIrp =
-                CONTAINING_RECORD(NextIrpEntry, IRP, Tail.Overlay.ListEntry);
-            NextIrpSp = IoGetCurrentIrpStackLocation( NextIrp );
-            SendReq = GetLockedData(NextIrp, NextIrpSp);
-
-            UnlockBuffers( SendReq->BufferArray,
-                           SendReq->BufferCount,
-                           FALSE );
-
-            NextIrp->IoStatus.Status = Status;
-            NextIrp->IoStatus.Information = 0;
-
-            if ( NextIrp->MdlAddress ) UnlockRequest( NextIrp, IoGetCurrentIrpStackLocation( NextIrp ) );
-            (void)IoSetCancelRoutine(NextIrp, NULL);
-            IoCompleteRequest( NextIrp, IO_NETWORK_INCREMENT );
-        }
+        FailPendingSends(FCB, Status);
 
         RetryDisconnectCompletion(FCB);
 
@@ -257,6 +247,181 @@ static NTSTATUS NTAPI SendComplete
     return STATUS_SUCCESS;
 }
 
+static DRIVER_CANCEL DirectSendCancel;
+static VOID NTAPI DirectSendCancel
+( PDEVICE_OBJECT DeviceObject,
+  PIRP Irp ) {
+    PIO_STACK_LOCATION IrpSp = IoGetCurrentIrpStackLocation(Irp);
+    PAFD_FCB FCB = IrpSp->FileObject->FsContext;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+
+    IoReleaseCancelSpinLock(Irp->CancelIrql);
+
+    if( !SocketAcquireStateLock( FCB ) )
+        return;
+
+    /* The transport is still reading the user's pages, so the IRP can't be
+     * completed here. Cancel the piece in flight instead and leave it to
+     * DirectSendComplete to complete the IRP with what was sent. */
+    if (FCB->PendingIrpList[FUNCTION_SEND].Flink == &Irp->Tail.Overlay.ListEntry &&
+        FCB->SendIrp.InFlightRequest)
+    {
+        IoCancelIrp(FCB->SendIrp.InFlightRequest);
+    }
+
+    SocketStateUnlock( FCB );
+}
+
+static IO_COMPLETION_ROUTINE DirectSendComplete;
+static NTSTATUS NTAPI DirectSendComplete
+( PDEVICE_OBJECT DeviceObject,
+  PIRP Irp,
+  PVOID Context ) {
+    NTSTATUS Status = Irp->IoStatus.Status;
+    PAFD_FCB FCB = (PAFD_FCB)Context;
+    PLIST_ENTRY NextIrpEntry;
+    PIRP NextIrp;
+    PIO_STACK_LOCATION NextIrpSp;
+    PAFD_SEND_INFO SendReq;
+    PAFD_MAPBUF Map;
+    SIZE_T BytesLeft;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+
+    /*
+     * This completes a send that was handed to the transport straight from
+     * the user's buffer. The user IRP is at the head of the pending list;
+     * anything queued behind it was copied into the send window meanwhile.
+     */
+
+    AFD_DbgPrint(MID_TRACE,("Called, status %x, %u bytes used\n",
+                            Irp->IoStatus.Status,
+                            Irp->IoStatus.Information));
+
+    if( !SocketAcquireStateLock( FCB ) )
+        return STATUS_FILE_CLOSED;
+
+    ASSERT(FCB->SendIrp.InFlightRequest == Irp);
+    FCB->SendIrp.InFlightRequest = NULL;
+    /* Request is not in flight any longer */
+
+    if( FCB->State == SOCKET_STATE_CLOSED ) {
+        /* Cleanup our IRP queue because the FCB is being destroyed */
+        FailPendingSends(FCB, STATUS_FILE_CLOSED);
+
+        RetryDisconnectCompletion(FCB);
+
+        SocketStateUnlock( FCB );
+        return STATUS_FILE_CLOSED;
+    }
+
+    ASSERT(!IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]));
+
+    NextIrpEntry = FCB->PendingIrpList[FUNCTION_SEND].Flink;
+    NextIrp = CONTAINING_RECORD(NextIrpEntry, IRP, Tail.Overlay.ListEntry);
+    NextIrpSp = IoGetCurrentIrpStackLocation( NextIrp );
+    SendReq = GetLockedData(NextIrp, NextIrpSp);
+    Map = (PAFD_MAPBUF)(SendReq->BufferArray + SendReq->BufferCount);
+
+    if( !NT_SUCCESS(Status) ) {
+        /* Earlier pieces did go out, so report those like a short send
+         * rather than failing the whole request */
+        RemoveHeadList(&FCB->PendingIrpList[FUNCTION_SEND]);
+
+        if (NextIrp->IoStatus.Information != 0)
+            NextIrp->IoStatus.Status = STATUS_SUCCESS;
+        else
+            NextIrp->IoStatus.Status = Status;
+
+        UnlockBuffers( SendReq->BufferArray,
+                       SendReq->BufferCount,
+                       FALSE );
+
+        if (NextIrp->MdlAddress) UnlockRequest(NextIrp, NextIrpSp);
+
+        (void)IoSetCancelRoutine(NextIrp, NULL);
+        IoCompleteRequest(NextIrp, IO_NETWORK_INCREMENT);
+
+        /* Complete all following send IRPs with error */
+        FailPendingSends(FCB, Status);
+
+        RetryDisconnectCompletion(FCB);
+
+        SocketStateUnlock( FCB );
+
+        return STATUS_SUCCESS;
+    }
+
+    /* We use the IRP tail for the number of bytes not sent yet */
+    BytesLeft = (ULONG_PTR)NextIrp->Tail.Overlay.DriverContext[3];
+    ASSERT(BytesLeft >= Irp->IoStatus.Information);
+    BytesLeft -= Irp->IoStatus.Information;
+    NextIrp->Tail.Overlay.DriverContext[3] = (PVOID)BytesLeft;
+    NextIrp->IoStatus.Information += Irp->IoStatus.Information;
+
+    /* The transport took part of it, so carry on from where it stopped
+     * unless the user gave up on the rest */
+    if (BytesLeft != 0 && Irp->IoStatus.Information != 0 && !NextIrp->Cancel)
+    {
+        Status = TdiSend(&FCB->SendIrp.InFlightRequest,
+                         FCB->Connection.Object,
+                         0,
+                         (PCHAR)Map[0].BufferAddress + NextIrp->IoStatus.Information,
+                         MIN(BytesLeft, AFD_DIRECT_SEND_CHUNK),
+                         DirectSendComplete,
+                         FCB);
+        if (Status == STATUS_PENDING)
+        {
+            SocketStateUnlock( FCB );
+            return STATUS_SUCCESS;
+        }
+    }
+
+    /* Done with the user buffer, complete the request with what was sent */
+    RemoveHeadList(&FCB->PendingIrpList[FUNCTION_SEND]);
+
+    NextIrp->IoStatus.Status = STATUS_SUCCESS;
+
+    UnlockBuffers( SendReq->BufferArray,
+                   SendReq->BufferCount,
+                   FALSE );
+
+    if (NextIrp->MdlAddress) UnlockRequest(NextIrp, NextIrpSp);
+
+    (void)IoSetCancelRoutine(NextIrp, NULL);
+    IoCompleteRequest(NextIrp, IO_NETWORK_INCREMENT);
+
+    if (FCB->Send.Size - FCB->Send.BytesUsed != 0 && !FCB->SendClosed &&
+        IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]))
+    {
+        FCB->PollState |= AFD_EVENT_SEND;
+        FCB->PollStatus[FD_WRITE_BIT] = STATUS_SUCCESS;
+        PollReeval( FCB->DeviceExt, FCB->FileObject );
+    }
+
+    /* Sends queued behind us are waiting in the window */
+    if( FCB->Send.BytesUsed )
+    {
+        Status = TdiSend( &FCB->SendIrp.InFlightRequest,
+                          FCB->Connection.Object,
+                          0,
+                          FCB->Send.Window,
+                          FCB->Send.BytesUsed,
+                          SendComplete,
+                          FCB );
+    }
+    else
+    {
+        /* Nothing is waiting so try to complete a pending disconnect */
+        RetryDisconnectCompletion(FCB);
+    }
+
+    SocketStateUnlock( FCB );
+
+    return STATUS_SUCCESS;
+}
+
 static IO_COMPLETION_ROUTINE PacketSocketSendComplete;
 static NTSTATUS NTAPI PacketSocketSendComplete
 ( PDEVICE_OBJECT DeviceObject,
@@ -334,6 +499,7 @@ AfdConnectedSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     PAFD_SEND_INFO SendReq;
     UINT TotalBytesCopied = 0, i, SpaceAvail = 0, BytesCopied, SendLength;
     KPROCESSOR_MODE LockMode;
+    PAFD_MAPBUF Map;
 
     UNREFERENCED_PARAMETER(DeviceObject);
     UNREFERENCED_PARAMETER(Short);
@@ -460,11 +626,6 @@ AfdConnectedSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     AFD_DbgPrint(MID_TRACE,("FCB->Send.BytesUsed = %u\n",
                             FCB->Send.BytesUsed));
 
-    SpaceAvail = FCB->Send.Size - FCB->Send.BytesUsed;
-
-    AFD_DbgPrint(MID_TRACE,("We can accept %u bytes\n",
-                            SpaceAvail));
-
     /* Count the total transfer size */
     SendLength = 0;
     for (i = 0; i < SendReq->BufferCount; i++)
@@ -472,6 +633,81 @@ AfdConnectedSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
         SendLength += SendReq->BufferArray[i].len;
     }
 
+    /* A send larger than the window with nothing ahead of it is handed to
+     * the transport straight from the locked user buffer instead of being
+     * copied through the window piece by piece. That keeps the IRP pending
+     * until everything is sent, so non-blocking sends stay on the window
+     * path where they can complete with partial progress right away. */
+    Map = (PAFD_MAPBUF)(SendReq->BufferArray + SendReq->BufferCount);
+    if (SendReq->BufferCount == 1 && Map[0].Mdl &&
+        !((SendReq->AfdFlags & AFD_IMMEDIATE) || (FCB->NonBlocking)) &&
+        SendLength > FCB->Send.Size &&
+        FCB->Send.BytesUsed == 0 &&
+        !FCB->SendIrp.InFlightRequest &&
+        IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]))
+    {
+        /* The mapping goes away when UnlockBuffers unlocks the MDL */
+        Map[0].BufferAddress = MmGetSystemAddressForMdlSafe(Map[0].Mdl,
+                                                            NormalPagePriority);
+    }
+    else
+    {
+        Map = NULL;
+    }
+
+    if (Map && Map[0].BufferAddress)
+    {
+        AFD_DbgPrint(MID_TRACE,("Sending %u bytes directly\n", SendLength));
+
+        /* We use the IRP tail for the number of bytes not sent yet */
+        Irp->IoStatus.Information = 0;
+        Irp->Tail.Overlay.DriverContext[3] = (PVOID)(ULONG_PTR)SendLength;
+
+        /* Same as QueueUserModeIrp, but the transport reads the user's
+         * pages from now on, so a cancel has to go through DirectSendCancel */
+        InsertTailList(&FCB->PendingIrpList[FUNCTION_SEND],
+                       &Irp->Tail.Overlay.ListEntry);
+
+        IoAcquireCancelSpinLock(&Irp->CancelIrql);
+        if (Irp->Cancel)
+        {
+            IoReleaseCancelSpinLock(Irp->CancelIrql);
+            RemoveEntryList(&Irp->Tail.Overlay.ListEntry);
+            UnlockBuffers(SendReq->BufferArray, SendReq->BufferCount, FALSE);
+            return UnlockAndMaybeComplete(FCB, STATUS_CANCELLED, Irp, 0);
+        }
+        (void)IoSetCancelRoutine(Irp, DirectSendCancel);
+        IoReleaseCancelSpinLock(Irp->CancelIrql);
+        IoMarkIrpPending(Irp);
+
+        Status = TdiSend(&FCB->SendIrp.InFlightRequest,
+                         FCB->Connection.Object,
+                         0,
+                         Map[0].BufferAddress,
+                         MIN(SendLength, AFD_DIRECT_SEND_CHUNK),
+                         DirectSendComplete,
+                         FCB);
+        if (Status != STATUS_PENDING)
+        {
+            NT_VERIFY(RemoveHeadList(&FCB->PendingIrpList[FUNCTION_SEND]) == &Irp->Tail.Overlay.ListEntry);
+            Irp->IoStatus.Status = Status;
+            Irp->IoStatus.Information = 0;
+            UnlockBuffers(SendReq->BufferArray, SendReq->BufferCount, FALSE);
+            if (Irp->MdlAddress) UnlockRequest(Irp, IrpSp);
+            (void)IoSetCancelRoutine(Irp, NULL);
+            IoCompleteRequest(Irp, IO_NETWORK_INCREMENT);
+        }
+
+        SocketStateUnlock(FCB);
+
+        return STATUS_PENDING;
+    }
+
+    SpaceAvail = FCB->Send.Size - FCB->Send.BytesUsed;
+
+    AFD_DbgPrint(MID_TRACE,("We can accept %u bytes\n",
+                            SpaceAvail));
+
     /* Make sure we've got the space */
     if (SendLength > SpaceAvail)
     {
@@ -92,6 +92,10 @@ typedef struct IPADDR_ENTRY {
 
 #define IN_FLIGHT_REQUESTS              5
 
+#define AFD_DIRECT_SEND_CHUNK           0x8000 /* Largest piece of a direct
+					       * send handed to the transport
+					       * in one TDI_SEND. */
+
 #define EXTRA_LOCK_BUFFERS              2 /* Number of extra buffers needed
 					   * for ancillary data on packet
 					   * requests. */
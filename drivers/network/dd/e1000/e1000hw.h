@@ -104,9 +104,13 @@ C_ASSERT(sizeof(E1000_TRANSMIT_DESCRIPTOR) == 16);
 
 
 /* Valid Range: 80-256 for 82542 and 82543 gigabit ethernet controllers
-   Valid Range: 80-4096 for 82544 and newer */
-#define NUM_TRANSMIT_DESCRIPTORS        128
-#define NUM_RECEIVE_DESCRIPTORS         128
+   Valid Range: 80-4096 for 82544 and newer
+   The ring length must be a multiple of 128 bytes (8 descriptors) */
+#define MIN_DESCRIPTORS                 80
+#define MAX_DESCRIPTORS_82543           256
+#define MAX_DESCRIPTORS                 4096
+#define DEFAULT_TRANSMIT_DESCRIPTORS    256
+#define DEFAULT_RECEIVE_DESCRIPTORS     256
 
 
 
@@ -192,6 +196,12 @@ C_ASSERT(sizeof(E1000_TRANSMIT_DESCRIPTOR) == 16);
 #define MAX_INTS_PER_SEC        2000
 #define DEFAULT_ITR             1000000000/(MAX_INTS_PER_SEC * 256)
 
+/* The interval is in units of 256 ns */
+#define ITR_FROM_INTS_PER_SEC(x)    (1000000000 / ((x) * 256))
+#define ITR_LOWEST_LATENCY      ITR_FROM_INTS_PER_SEC(20000)
+#define ITR_LOW_LATENCY         ITR_FROM_INTS_PER_SEC(8000)
+#define ITR_BULK_LATENCY        DEFAULT_ITR
+
 
 /* E1000_REG_RCTL */
 #define E1000_RCTL_EN               (1 << 1)    /* Receiver Enable */
@@ -361,9 +361,19 @@ NICAllocateIoResources(
                              Adapter->IoAddress,
                              Adapter->IoLength);
 
+    Status = NdisAllocateMemoryWithTag((PVOID*)&Adapter->TransmitPackets,
+                                       sizeof(PNDIS_PACKET) * Adapter->TransmitDescriptorCount,
+                                       E1000_TAG);
+    if (Status != NDIS_STATUS_SUCCESS)
+    {
+        NDIS_DbgPrint(MIN_TRACE, ("Unable to allocate transmit packet array\n"));
+        return NDIS_STATUS_RESOURCES;
+    }
+
+    RtlZeroMemory(Adapter->TransmitPackets, sizeof(PNDIS_PACKET) * Adapter->TransmitDescriptorCount);
 
     NdisMAllocateSharedMemory(Adapter->AdapterHandle,
-                              sizeof(E1000_TRANSMIT_DESCRIPTOR) * NUM_TRANSMIT_DESCRIPTORS,
+                              sizeof(E1000_TRANSMIT_DESCRIPTOR) * Adapter->TransmitDescriptorCount,
                               FALSE,
                               (PVOID*)&Adapter->TransmitDescriptors,
                               &Adapter->TransmitDescriptorsPa);
@@ -373,7 +383,7 @@ NICAllocateIoResources(
         return NDIS_STATUS_RESOURCES;
     }
 
-    for (n = 0; n < NUM_TRANSMIT_DESCRIPTORS; ++n)
+    for (n = 0; n < Adapter->TransmitDescriptorCount; ++n)
     {
         PE1000_TRANSMIT_DESCRIPTOR Descriptor = Adapter->TransmitDescriptors + n;
         Descriptor->Address = 0;
@@ -381,7 +391,7 @@ NICAllocateIoResources(
     }
 
     NdisMAllocateSharedMemory(Adapter->AdapterHandle,
-                              sizeof(E1000_RECEIVE_DESCRIPTOR) * NUM_RECEIVE_DESCRIPTORS,
+                              sizeof(E1000_RECEIVE_DESCRIPTOR) * Adapter->ReceiveDescriptorCount,
                               FALSE,
                               (PVOID*)&Adapter->ReceiveDescriptors,
                               &Adapter->ReceiveDescriptorsPa);
@@ -396,7 +406,7 @@ NICAllocateIoResources(
     Adapter->ReceiveBufferEntrySize = AllocationSize;
 
     NdisMAllocateSharedMemory(Adapter->AdapterHandle,
-                              Adapter->ReceiveBufferEntrySize * NUM_RECEIVE_DESCRIPTORS,
+                              Adapter->ReceiveBufferEntrySize * Adapter->ReceiveDescriptorCount,
                               FALSE,
                               (PVOID*)&Adapter->ReceiveBuffer,
                               &Adapter->ReceiveBufferPa);
@@ -407,7 +417,7 @@ NICAllocateIoResources(
         return NDIS_STATUS_RESOURCES;
     }
 
-    for (n = 0; n < NUM_RECEIVE_DESCRIPTORS; ++n)
+    for (n = 0; n < Adapter->ReceiveDescriptorCount; ++n)
     {
         PE1000_RECEIVE_DESCRIPTOR Descriptor = Adapter->ReceiveDescriptors + n;
 
@@ -476,7 +486,7 @@ NICReleaseIoResources(
         }
 
         NdisMFreeSharedMemory(Adapter->AdapterHandle,
-                              sizeof(E1000_RECEIVE_DESCRIPTOR) * NUM_RECEIVE_DESCRIPTORS,
+                              sizeof(E1000_RECEIVE_DESCRIPTOR) * Adapter->ReceiveDescriptorCount,
                               FALSE,
                               Adapter->ReceiveDescriptors,
                               Adapter->ReceiveDescriptorsPa);
@@ -487,7 +497,7 @@ NICReleaseIoResources(
     if (Adapter->ReceiveBuffer != NULL)
     {
         NdisMFreeSharedMemory(Adapter->AdapterHandle,
-                              Adapter->ReceiveBufferEntrySize * NUM_RECEIVE_DESCRIPTORS,
+                              Adapter->ReceiveBufferEntrySize * Adapter->ReceiveDescriptorCount,
                               FALSE,
                               Adapter->ReceiveBuffer,
                               Adapter->ReceiveBufferPa);
@@ -507,7 +517,7 @@ NICReleaseIoResources(
         }
 
         NdisMFreeSharedMemory(Adapter->AdapterHandle,
-                              sizeof(E1000_TRANSMIT_DESCRIPTOR) * NUM_TRANSMIT_DESCRIPTORS,
+                              sizeof(E1000_TRANSMIT_DESCRIPTOR) * Adapter->TransmitDescriptorCount,
                               FALSE,
                               Adapter->TransmitDescriptors,
                               Adapter->TransmitDescriptorsPa);
@@ -515,6 +525,14 @@ NICReleaseIoResources(
         Adapter->TransmitDescriptors = NULL;
     }
 
+    if (Adapter->TransmitPackets != NULL)
+    {
+        NdisFreeMemory(Adapter->TransmitPackets,
+                       sizeof(PNDIS_PACKET) * Adapter->TransmitDescriptorCount,
+                       0);
+
+        Adapter->TransmitPackets = NULL;
+    }
 
 
     if (Adapter->IoPort)
@@ -618,7 +636,7 @@ NICEnableTxRx(
     E1000WriteUlong(Adapter, E1000_REG_TDBAL, Adapter->TransmitDescriptorsPa.LowPart);
 
     /* Transmit descriptor buffer size */
-    E1000WriteUlong(Adapter, E1000_REG_TDLEN, sizeof(E1000_TRANSMIT_DESCRIPTOR) * NUM_TRANSMIT_DESCRIPTORS);
+    E1000WriteUlong(Adapter, E1000_REG_TDLEN, sizeof(E1000_TRANSMIT_DESCRIPTOR) * Adapter->TransmitDescriptorCount);
 
     /* Transmit descriptor tail / head */
     E1000WriteUlong(Adapter, E1000_REG_TDH, 0);
@@ -643,16 +661,19 @@ NICEnableTxRx(
     E1000WriteUlong(Adapter, E1000_REG_RDBAL, Adapter->ReceiveDescriptorsPa.LowPart);
 
     /* Receive descriptor buffer size */
-    E1000WriteUlong(Adapter, E1000_REG_RDLEN, sizeof(E1000_RECEIVE_DESCRIPTOR) * NUM_RECEIVE_DESCRIPTORS);
+    E1000WriteUlong(Adapter, E1000_REG_RDLEN, sizeof(E1000_RECEIVE_DESCRIPTOR) * Adapter->ReceiveDescriptorCount);
 
     /* Receive descriptor tail / head */
     E1000WriteUlong(Adapter, E1000_REG_RDH, 0);
-    E1000WriteUlong(Adapter, E1000_REG_RDT, NUM_RECEIVE_DESCRIPTORS - 1);
+    E1000WriteUlong(Adapter, E1000_REG_RDT, Adapter->ReceiveDescriptorCount - 1);
 
     /* Set up interrupt timers */
     E1000WriteUlong(Adapter, E1000_REG_RADV, 96);
     E1000WriteUlong(Adapter, E1000_REG_RDTR, 16);
 
+    /* Cap the interrupt rate, NICUpdateInterruptThrottle adjusts it later */
+    E1000WriteUlong(Adapter, E1000_REG_ITR, Adapter->InterruptThrottle);
+
     /* Some defaults */
     Value = E1000_RCTL_SECRC | E1000_RCTL_EN;
 
@@ -820,6 +841,44 @@ NICUpdateLinkStatus(
     Adapter->LinkSpeedMbps = SpeedValues[SpeedIndex];
 }
 
+VOID
+NTAPI
+NICUpdateInterruptThrottle(
+    IN PE1000_ADAPTER Adapter,
+    IN ULONG Packets)
+{
+    ULONG CurrentTime, Elapsed, PacketRate, Throttle;
+
+    Adapter->ThrottlePackets += Packets;
+
+    NdisGetSystemUpTime(&CurrentTime);
+    Elapsed = CurrentTime - Adapter->ThrottleUpdateTime;
+
+    /* Look at the packet rate a few times per second */
+    if (Elapsed < 250)
+        return;
+
+    PacketRate = (ULONG)((ULONGLONG)Adapter->ThrottlePackets * 1000 / Elapsed);
+    Adapter->ThrottlePackets = 0;
+    Adapter->ThrottleUpdateTime = CurrentTime;
+
+    /* Light traffic gets its interrupts quickly, bulk traffic gets them batched */
+    if (PacketRate < 2000)
+        Throttle = ITR_LOWEST_LATENCY;
+    else if (PacketRate < 20000)
+        Throttle = ITR_LOW_LATENCY;
+    else
+        Throttle = ITR_BULK_LATENCY;
+
+    if (Throttle != Adapter->InterruptThrottle)
+    {
+        NDIS_DbgPrint(MID_TRACE, ("%u packets/s, setting ITR to %u\n", PacketRate, Throttle));
+
+        Adapter->InterruptThrottle = Throttle;
+        E1000WriteUlong(Adapter, E1000_REG_ITR, Throttle);
+    }
+}
+
 NDIS_STATUS
 NTAPI
 NICTransmitPacket(
@@ -840,7 +899,7 @@ NICTransmitPacket(
     TransmitDescriptor->ChecksumStartField = 0;
     TransmitDescriptor->Special = 0;
 
-    Adapter->CurrentTxDesc = (Adapter->CurrentTxDesc + 1) % NUM_TRANSMIT_DESCRIPTORS;
+    Adapter->CurrentTxDesc = (Adapter->CurrentTxDesc + 1) % Adapter->TransmitDescriptorCount;
 
     E1000WriteUlong(Adapter, E1000_REG_TDT, Adapter->CurrentTxDesc);
 
@@ -41,6 +41,7 @@ MiniportHandleInterrupt(
     IN NDIS_HANDLE MiniportAdapterContext)
 {
     ULONG InterruptPending;
+    ULONG PacketCount = 0;
     PE1000_ADAPTER Adapter = (PE1000_ADAPTER)MiniportAdapterContext;
     volatile PE1000_TRANSMIT_DESCRIPTOR TransmitDescriptor;
 
@@ -80,9 +81,9 @@ MiniportHandleInterrupt(
         E1000ReadUlong(Adapter, E1000_REG_RDH, &RxDescHead);
         E1000ReadUlong(Adapter, E1000_REG_RDT, &RxDescTail);
 
-        while (((RxDescTail + 1) % NUM_RECEIVE_DESCRIPTORS) != RxDescHead)
+        while (((RxDescTail + 1) % Adapter->ReceiveDescriptorCount) != RxDescHead)
         {
-            CurrRxDesc = (RxDescTail + 1) % NUM_RECEIVE_DESCRIPTORS;
+            CurrRxDesc = (RxDescTail + 1) % Adapter->ReceiveDescriptorCount;
             BufferOffset = CurrRxDesc * Adapter->ReceiveBufferEntrySize;
             ReceiveDescriptor = Adapter->ReceiveDescriptors + CurrRxDesc;
 
@@ -114,6 +115,7 @@ MiniportHandleInterrupt(
                                         ReceiveDescriptor->Length - sizeof(ETH_HEADER));
 
                 bGotAny = TRUE;
+                PacketCount++;
             }
             else
             {
@@ -141,44 +143,55 @@ MiniportHandleInterrupt(
     if (InterruptPending & (E1000_IMS_TXD_LOW | E1000_IMS_TXDW | E1000_IMS_TXQE))
     {
         PNDIS_PACKET AckPackets[40] = {0};
-        ULONG NumPackets = 0, i;
+        ULONG NumPackets, i;
 
         /* Clear out these interrupts */
         InterruptPending &= ~(E1000_IMS_TXD_LOW | E1000_IMS_TXDW | E1000_IMS_TXQE);
 
-        while ((Adapter->TxFull || Adapter->LastTxDesc != Adapter->CurrentTxDesc) && NumPackets < ARRAYSIZE(AckPackets))
+        /* With moderated interrupts there can be more finished descriptors
+         * than fit in AckPackets, so keep going until we find a busy one */
+        do
         {
-            TransmitDescriptor = Adapter->TransmitDescriptors + Adapter->LastTxDesc;
+            NumPackets = 0;
 
-            if (TransmitDescriptor->Status & E1000_TDESC_STATUS_DD)
+            while ((Adapter->TxFull || Adapter->LastTxDesc != Adapter->CurrentTxDesc) && NumPackets < ARRAYSIZE(AckPackets))
             {
-                if (Adapter->TransmitPackets[Adapter->LastTxDesc])
+                TransmitDescriptor = Adapter->TransmitDescriptors + Adapter->LastTxDesc;
+
+                if (TransmitDescriptor->Status & E1000_TDESC_STATUS_DD)
                 {
-                    AckPackets[NumPackets++] = Adapter->TransmitPackets[Adapter->LastTxDesc];
-                    Adapter->TransmitPackets[Adapter->LastTxDesc] = NULL;
-                    TransmitDescriptor->Status = 0;
+                    if (Adapter->TransmitPackets[Adapter->LastTxDesc])
+                    {
+                        AckPackets[NumPackets++] = Adapter->TransmitPackets[Adapter->LastTxDesc];
+                        Adapter->TransmitPackets[Adapter->LastTxDesc] = NULL;
+                        TransmitDescriptor->Status = 0;
+                    }
+
+                    Adapter->LastTxDesc = (Adapter->LastTxDesc + 1) % Adapter->TransmitDescriptorCount;
+                    Adapter->TxFull = FALSE;
+                }
+                else
+                {
+                    break;
                 }
-
-                Adapter->LastTxDesc = (Adapter->LastTxDesc + 1) % NUM_TRANSMIT_DESCRIPTORS;
-                Adapter->TxFull = FALSE;
             }
-            else
+
+            if (NumPackets)
             {
-                break;
-            }
-        }
+                NDIS_DbgPrint(MAX_TRACE, ("Tx: (TDH: %u, TDT: %u)\n", Adapter->CurrentTxDesc, Adapter->LastTxDesc));
+                NDIS_DbgPrint(MAX_TRACE, ("Tx Done: %u packets to ack\n", NumPackets));
 
-        if (NumPackets)
-        {
-            NDIS_DbgPrint(MAX_TRACE, ("Tx: (TDH: %u, TDT: %u)\n", Adapter->CurrentTxDesc, Adapter->LastTxDesc));
-            NDIS_DbgPrint(MAX_TRACE, ("Tx Done: %u packets to ack\n", NumPackets));
+                for (i = 0; i < NumPackets; ++i)
+                {
+                    NdisMSendComplete(Adapter->AdapterHandle, AckPackets[i], NDIS_STATUS_SUCCESS);
+                }
 
-            for (i = 0; i < NumPackets; ++i)
-            {
-                NdisMSendComplete(Adapter->AdapterHandle, AckPackets[i], NDIS_STATUS_SUCCESS);
+                PacketCount += NumPackets;
             }
-        }
+        } while (NumPackets == ARRAYSIZE(AckPackets));
     }
 
+    NICUpdateInterruptThrottle(Adapter, PacketCount);
+
     ASSERT(InterruptPending == 0);
 }
@@ -83,6 +83,42 @@ MiniportHalt(
     NdisFreeMemory(Adapter, sizeof(*Adapter), 0);
 }
 
+static
+ULONG
+E1000ReadDescriptorCount(
+    IN NDIS_HANDLE ConfigurationHandle,
+    IN PCWSTR Keyword,
+    IN ULONG DefaultCount,
+    IN ULONG MaximumCount)
+{
+    NDIS_STATUS Status;
+    NDIS_STRING KeywordString;
+    PNDIS_CONFIGURATION_PARAMETER ConfigurationParameter;
+    ULONG Count = DefaultCount;
+
+    if (ConfigurationHandle != NULL)
+    {
+        NdisInitUnicodeString(&KeywordString, Keyword);
+        NdisReadConfiguration(&Status,
+                              &ConfigurationParameter,
+                              ConfigurationHandle,
+                              &KeywordString,
+                              NdisParameterInteger);
+        if (Status == NDIS_STATUS_SUCCESS)
+        {
+            Count = ConfigurationParameter->ParameterData.IntegerData;
+        }
+    }
+
+    if (Count < MIN_DESCRIPTORS)
+        Count = MIN_DESCRIPTORS;
+    if (Count > MaximumCount)
+        Count = MaximumCount;
+
+    /* The ring length must be a multiple of 128 bytes */
+    return Count & ~7;
+}
+
 NDIS_STATUS
 NTAPI
 MiniportInitialize(
@@ -99,6 +135,8 @@ MiniportInitialize(
     PNDIS_RESOURCE_LIST ResourceList;
     UINT ResourceListSize;
     PCI_COMMON_CONFIG PciConfig;
+    NDIS_HANDLE ConfigurationHandle;
+    ULONG MaximumDescriptors;
 
     /* Make sure the medium is supported */
     for (i = 0; i < MediumArraySize; i++)
@@ -158,6 +196,37 @@ MiniportInitialize(
         goto Cleanup;
     }
 
+    /* The ring sizes can be tuned with the standard registry keywords */
+    NdisOpenConfiguration(&Status, &ConfigurationHandle, WrapperConfigurationContext);
+    if (Status != NDIS_STATUS_SUCCESS)
+    {
+        ConfigurationHandle = NULL;
+    }
+
+    /* 82542 and 82543 controllers only take up to 256 descriptors */
+    MaximumDescriptors = (Adapter->DeviceID <= 0x1004) ? MAX_DESCRIPTORS_82543 : MAX_DESCRIPTORS;
+
+    Adapter->TransmitDescriptorCount = E1000ReadDescriptorCount(ConfigurationHandle,
+                                                                L"*TransmitBuffers",
+                                                                DEFAULT_TRANSMIT_DESCRIPTORS,
+                                                                MaximumDescriptors);
+    Adapter->ReceiveDescriptorCount = E1000ReadDescriptorCount(ConfigurationHandle,
+                                                               L"*ReceiveBuffers",
+                                                               DEFAULT_RECEIVE_DESCRIPTORS,
+                                                               MaximumDescriptors);
+
+    if (ConfigurationHandle != NULL)
+    {
+        NdisCloseConfiguration(ConfigurationHandle);
+    }
+
+    NDIS_DbgPrint(MID_TRACE, ("Using %u TX and %u RX descriptors\n",
+                              Adapter->TransmitDescriptorCount,
+                              Adapter->ReceiveDescriptorCount));
+
+    Adapter->InterruptThrottle = DEFAULT_ITR;
+    NdisGetSystemUpTime(&Adapter->ThrottleUpdateTime);
+
     /* Get our resources for IRQ and IO base information */
     NdisMQueryAdapterResources(&Status,
                                WrapperConfigurationContext,
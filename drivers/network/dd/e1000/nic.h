@@ -69,8 +69,9 @@ typedef struct _E1000_ADAPTER
     /* Transmit */
     PE1000_TRANSMIT_DESCRIPTOR TransmitDescriptors;
     NDIS_PHYSICAL_ADDRESS TransmitDescriptorsPa;
+    ULONG TransmitDescriptorCount;
 
-    PNDIS_PACKET TransmitPackets[NUM_TRANSMIT_DESCRIPTORS];
+    PNDIS_PACKET *TransmitPackets;
 
     ULONG CurrentTxDesc;
     ULONG LastTxDesc;
@@ -80,12 +81,19 @@ typedef struct _E1000_ADAPTER
     /* Receive */
     PE1000_RECEIVE_DESCRIPTOR ReceiveDescriptors;
     NDIS_PHYSICAL_ADDRESS ReceiveDescriptorsPa;
+    ULONG ReceiveDescriptorCount;
 
     E1000_RCVBUF_SIZE ReceiveBufferType;
     volatile PUCHAR ReceiveBuffer;
     NDIS_PHYSICAL_ADDRESS ReceiveBufferPa;
     ULONG ReceiveBufferEntrySize;
 
+
+    /* Interrupt moderation */
+    ULONG InterruptThrottle;
+    ULONG ThrottlePackets;
+    ULONG ThrottleUpdateTime;
+
 } E1000_ADAPTER, *PE1000_ADAPTER;
 
 
@@ -177,6 +185,12 @@ NTAPI
 NICUpdateLinkStatus(
     IN PE1000_ADAPTER Adapter);
 
+VOID
+NTAPI
+NICUpdateInterruptThrottle(
+    IN PE1000_ADAPTER Adapter,
+    IN ULONG Packets);
+
 NDIS_STATUS
 NTAPI
 NICTransmitPacket(
@@ -7,7 +7,7 @@
 
 #pragma once
 
-#define NB_HASHMASK 0xF /* Hash mask for neighbor cache */
+#define NB_HASHMASK 0xFF /* Hash mask for neighbor cache */
 
 typedef VOID (*PNEIGHBOR_PACKET_COMPLETE)
     ( PVOID Context, PNDIS_PACKET Packet, NDIS_STATUS Status );
@@ -35,6 +35,7 @@ typedef struct NEIGHBOR_CACHE_ENTRY {
     PVOID LinkAddress;                  /* Pointer to link address */
     IP_ADDRESS Address;                 /* IP address of neighbor */
     LIST_ENTRY PacketQueue;             /* Packet queue */
+    UINT PacketCount;                   /* Number of packets in queue */
 } NEIGHBOR_CACHE_ENTRY, *PNEIGHBOR_CACHE_ENTRY;
 
 /* NCE states */
@@ -54,6 +55,9 @@ typedef struct NEIGHBOR_CACHE_ENTRY {
 /* Number of seconds before retransmission */
 #define ARP_TIMEOUT_RETRANSMISSION 3
 
+/* Maximum number of packets waiting on an NCE for address resolution */
+#define NB_MAX_QUEUED_PACKETS 32
+
 extern NEIGHBOR_CACHE_TABLE NeighborCache[NB_HASHMASK + 1];
 
 
@@ -18,8 +18,17 @@ typedef struct _FIB_ENTRY {
     IP_ADDRESS Netmask;           /* Netmask of network */
     PNEIGHBOR_CACHE_ENTRY Router; /* Pointer to NCE of router to use */
     UINT Metric;                  /* Cost of this route */
+    UINT PrefixLength;            /* Number of leading one bits in Netmask */
 } FIB_ENTRY, *PFIB_ENTRY;
 
+/* Route cache entry, remembers the route last chosen for an IPv4 destination */
+typedef struct _ROUTE_CACHE_ENTRY {
+    IPv4_RAW_ADDRESS Destination; /* Destination address */
+    PFIB_ENTRY FIBE;              /* Route used for it, NULL if unused */
+} ROUTE_CACHE_ENTRY, *PROUTE_CACHE_ENTRY;
+
+#define ROUTE_CACHE_SIZE 64
+
 PFIB_ENTRY RouterAddRoute(
     PIP_ADDRESS NetworkAddress,
     PIP_ADDRESS Netmask,
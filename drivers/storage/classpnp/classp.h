@@ -369,7 +369,15 @@ typedef struct _TRANSFER_PACKET {
  *  The absolute maximum number of packets that we will allocate is
  *  whatever is required by the current activity, up to the memory limit;
  *  as soon as stress ends, we snap down to MAX_WORKINGSET_TRANSFER_PACKETS;
- *  we then lazily work down to MIN_WORKINGSET_TRANSFER_PACKETS.
+ *  we then lazily work down to the device's working set.
+ *
+ *  The working set lies between the MIN and MAX numbers and follows the load:
+ *  once every TRANSFER_PACKET_WORKINGSET_INTERVAL we look at the peak number
+ *  of packets that were in use at the same time.  The working set jumps up
+ *  to that peak, but only decays halfway towards it, and the lazy free path
+ *  does not go below the peak of the current interval either, so that a
+ *  device with a bursty queue depth does not keep freeing and reallocating
+ *  the same packets.
  */
 #define MIN_INITIAL_TRANSFER_PACKETS                     1
 #define MIN_WORKINGSET_TRANSFER_PACKETS_Consumer      4
@@ -378,6 +386,7 @@ typedef struct _TRANSFER_PACKET {
 #define MAX_WORKINGSET_TRANSFER_PACKETS_Server      1024
 #define MIN_WORKINGSET_TRANSFER_PACKETS_Enterprise    256
 #define MAX_WORKINGSET_TRANSFER_PACKETS_Enterprise   2048
+#define TRANSFER_PACKET_WORKINGSET_INTERVAL     (1000 * 1000 * 10) // 1 second, in 100ns units
 
 
 //
@@ -437,6 +446,13 @@ struct _CLASS_PRIVATE_FDO_DATA {
     ULONG NumTotalTransferPackets;
     ULONG DbgPeakNumTransferPackets;
 
+    /*
+     *  Working set sizing, see TRANSFER_PACKET_WORKINGSET_INTERVAL.
+     */
+    ULONG WorkingSetTransferPackets;
+    ULONG PeakInUseTransferPackets;
+    ULONGLONG WorkingSetSampleTime;
+
     /*
      *  Queue for deferred client irps
      */
@@ -103,6 +103,14 @@ NTSTATUS NTAPI InitializeTransferPackets(PDEVICE_OBJECT Fdo)
         MaxWorkingSetTransferPackets = MAX_WORKINGSET_TRANSFER_PACKETS_Consumer;
     }
 
+    /*
+     *  Set up the working set before the first packet is enqueued, so that
+     *  EnqueueFreeTransferPacket does not take a sample from a zero start time.
+     */
+    fdoData->WorkingSetTransferPackets = MinWorkingSetTransferPackets;
+    fdoData->PeakInUseTransferPackets = 0;
+    fdoData->WorkingSetSampleTime = KeQueryInterruptTime();
+
     while (fdoData->NumFreeTransferPackets < MIN_INITIAL_TRANSFER_PACKETS){
         PTRANSFER_PACKET pkt = NewTransferPacket(Fdo);
         if (pkt){
@@ -214,12 +222,53 @@ VOID NTAPI DestroyTransferPacket(PTRANSFER_PACKET Pkt)
     ExFreePool(Pkt);
 }
 
+/*
+ *  UpdateTransferPacketWorkingSet
+ *
+ *      Resize the working set from the peak number of packets in use
+ *      during the last interval.  See TRANSFER_PACKET_WORKINGSET_INTERVAL.
+ */
+static VOID UpdateTransferPacketWorkingSet(PDEVICE_OBJECT Fdo, ULONGLONG Now)
+{
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_PRIVATE_FDO_DATA fdoData = fdoExt->PrivateFdoData;
+    ULONG workingSet, peakInUse;
+    KIRQL oldIrql;
+
+    /*
+     *  Check the interval again with the lock held,
+     *  only one thread gets to take the sample.
+     */
+    KeAcquireSpinLock(&fdoData->SpinLock, &oldIrql);
+    if (Now - fdoData->WorkingSetSampleTime < TRANSFER_PACKET_WORKINGSET_INTERVAL){
+        KeReleaseSpinLock(&fdoData->SpinLock, oldIrql);
+        return;
+    }
+
+    fdoData->WorkingSetSampleTime = Now;
+    peakInUse = fdoData->PeakInUseTransferPackets;
+    fdoData->PeakInUseTransferPackets = 0;
+
+    workingSet = fdoData->WorkingSetTransferPackets;
+    if (peakInUse >= workingSet){
+        workingSet = peakInUse;
+    }
+    else {
+        workingSet = (workingSet + peakInUse) / 2;
+    }
+    workingSet = MAX(workingSet, MinWorkingSetTransferPackets);
+    workingSet = MIN(workingSet, MaxWorkingSetTransferPackets);
+    fdoData->WorkingSetTransferPackets = workingSet;
+    KeReleaseSpinLock(&fdoData->SpinLock, oldIrql);
+}
+
 VOID NTAPI EnqueueFreeTransferPacket(PDEVICE_OBJECT Fdo, PTRANSFER_PACKET Pkt)
 {
     PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
     PCLASS_PRIVATE_FDO_DATA fdoData = fdoExt->PrivateFdoData;
     KIRQL oldIrql;
     ULONG newNumPkts;
+    ULONGLONG now;
     
     ASSERT(!Pkt->SlistEntry.Next);
 
@@ -227,12 +276,17 @@ VOID NTAPI EnqueueFreeTransferPacket(PDEVICE_OBJECT Fdo, PTRANSFER_PACKET Pkt)
     newNumPkts = InterlockedIncrement((PLONG)&fdoData->NumFreeTransferPackets);
     ASSERT(newNumPkts <= fdoData->NumTotalTransferPackets);
 
+    now = KeQueryInterruptTime();
+    if (now - fdoData->WorkingSetSampleTime >= TRANSFER_PACKET_WORKINGSET_INTERVAL){
+        UpdateTransferPacketWorkingSet(Fdo, now);
+    }
+
     /*
-     *  If the total number of packets is larger than MinWorkingSetTransferPackets,
+     *  If the total number of packets is larger than the working set,
      *  that means that we've been in stress.  If all those packets are now
      *  free, then we are now out of stress and can free the extra packets.
      *  Free down to MaxWorkingSetTransferPackets immediately, and
-     *  down to MinWorkingSetTransferPackets lazily (one at a time).
+     *  down to WorkingSetTransferPackets lazily (one at a time).
      */
     if (fdoData->NumFreeTransferPackets >= fdoData->NumTotalTransferPackets){
 
@@ -280,9 +334,11 @@ VOID NTAPI EnqueueFreeTransferPacket(PDEVICE_OBJECT Fdo, PTRANSFER_PACKET Pkt)
         }
 
         /*
-         *  2.  Lazily work down to our LOWER threshold (by only freeing one packet at a time).
+         *  2.  Lazily work down to our working set (by only freeing one packet at a time).
+         *      Don't go below the peak seen so far in this interval though,
+         *      since that is what the working set is about to grow to.
          */
-        if (fdoData->NumTotalTransferPackets > MinWorkingSetTransferPackets){
+        if (fdoData->NumTotalTransferPackets > MAX(fdoData->WorkingSetTransferPackets, fdoData->PeakInUseTransferPackets)){
             /*
              *  Check the counter again with lock held.  This eliminates a race condition
              *  while still allowing us to not grab the spinlock in the common codepath.
@@ -294,18 +350,18 @@ VOID NTAPI EnqueueFreeTransferPacket(PDEVICE_OBJECT Fdo, PTRANSFER_PACKET Pkt)
              */
             PTRANSFER_PACKET pktToDelete = NULL; 
 
-            DBGTRACE(ClassDebugTrace, ("Exiting stress, lazily freeing one of %d/%d packets.", fdoData->NumTotalTransferPackets, MinWorkingSetTransferPackets));
+            DBGTRACE(ClassDebugTrace, ("Exiting stress, lazily freeing one of %d/%d packets.", fdoData->NumTotalTransferPackets, fdoData->WorkingSetTransferPackets));
             
             KeAcquireSpinLock(&fdoData->SpinLock, &oldIrql);
             if ((fdoData->NumFreeTransferPackets >= fdoData->NumTotalTransferPackets) &&
-                (fdoData->NumTotalTransferPackets > MinWorkingSetTransferPackets)){
+                (fdoData->NumTotalTransferPackets > MAX(fdoData->WorkingSetTransferPackets, fdoData->PeakInUseTransferPackets))){
                 
                 pktToDelete = DequeueFreeTransferPacket(Fdo, FALSE);
                 if (pktToDelete){
                     InterlockedDecrement((PLONG)&fdoData->NumTotalTransferPackets);    
                 }
                 else {
-                    DBGTRACE(ClassDebugTrace, ("Extremely unlikely condition (non-fatal): %d packets dequeued at once for Fdo %p. NumTotalTransferPackets=%d (2).", MinWorkingSetTransferPackets, Fdo, fdoData->NumTotalTransferPackets));
+                    DBGTRACE(ClassDebugTrace, ("Extremely unlikely condition (non-fatal): %d packets dequeued at once for Fdo %p. NumTotalTransferPackets=%d (2).", fdoData->WorkingSetTransferPackets, Fdo, fdoData->NumTotalTransferPackets));
                 }
             }
             KeReleaseSpinLock(&fdoData->SpinLock, oldIrql);
@@ -355,6 +411,18 @@ PTRANSFER_PACKET NTAPI DequeueFreeTransferPacket(PDEVICE_OBJECT Fdo, BOOLEAN All
             pkt = NULL;
         }
     }
+
+    /*
+     *  Track how many packets are in use at once for the working set sizing.
+     *  This is only a hint, racing updates are fine.
+     */
+    if (pkt){
+        ULONG numTotal = fdoData->NumTotalTransferPackets;
+        ULONG numFree = fdoData->NumFreeTransferPackets;
+        if ((numTotal > numFree) && (numTotal - numFree > fdoData->PeakInUseTransferPackets)){
+            fdoData->PeakInUseTransferPackets = numTotal - numFree;
+        }
+    }
     
     return pkt;
 }
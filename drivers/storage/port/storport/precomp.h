@@ -31,6 +31,7 @@
 #define TAG_ADDRESS_MAPPING 'MAtS'
 #define TAG_INQUIRY_DATA    'QItS'
 #define TAG_SENSE_DATA      'NStS'
+#define TAG_SG_LIST         'GStS'
 
 typedef enum
 {
@@ -115,6 +116,9 @@ typedef struct _FDO_DEVICE_EXTENSION
     KSPIN_LOCK PdoListLock;
     LIST_ENTRY PdoListHead;
     ULONG PdoCount;
+
+    SLIST_HEADER ScatterGatherFreeList;
+    KDPC ScatterGatherFreeDpc;
 } FDO_DEVICE_EXTENSION, *PFDO_DEVICE_EXTENSION;
 
 
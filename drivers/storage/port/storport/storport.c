@@ -163,6 +163,55 @@ PortReleaseSpinLock(
 }
 
 
+static
+VOID
+NTAPI
+PortScatterGatherFreeDpc(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+{
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    PSLIST_ENTRY Entry;
+
+    DeviceExtension = (PFDO_DEVICE_EXTENSION)DeferredContext;
+
+    while ((Entry = InterlockedPopEntrySList(&DeviceExtension->ScatterGatherFreeList)) != NULL)
+        ExFreePoolWithTag(Entry, TAG_SG_LIST);
+}
+
+
+static
+VOID
+PortFreeScatterGatherList(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PIRP Irp)
+{
+    PSTOR_SCATTER_GATHER_LIST ScatterGatherList;
+
+    /* Storport owns DriverContext[0] from PortDispatchScsi on */
+    ScatterGatherList = Irp->Tail.Overlay.DriverContext[0];
+    if (ScatterGatherList == NULL)
+        return;
+
+    Irp->Tail.Overlay.DriverContext[0] = NULL;
+
+    /* Miniports complete requests from their interrupt routine too,
+       pool can only be freed up to DISPATCH_LEVEL */
+    if (KeGetCurrentIrql() <= DISPATCH_LEVEL)
+    {
+        ExFreePoolWithTag(ScatterGatherList, TAG_SG_LIST);
+    }
+    else
+    {
+        InterlockedPushEntrySList(&DeviceExtension->ScatterGatherFreeList,
+                                  (PSLIST_ENTRY)ScatterGatherList);
+        KeInsertQueueDpc(&DeviceExtension->ScatterGatherFreeDpc, NULL, NULL);
+    }
+}
+
+
 static
 NTSTATUS
 NTAPI
@@ -226,6 +275,11 @@ PortAddDevice(
     KeInitializeSpinLock(&DeviceExtension->PdoListLock);
     InitializeListHead(&DeviceExtension->PdoListHead);
 
+    InitializeSListHead(&DeviceExtension->ScatterGatherFreeList);
+    KeInitializeDpc(&DeviceExtension->ScatterGatherFreeDpc,
+                    PortScatterGatherFreeDpc,
+                    DeviceExtension);
+
     /* Attach the FDO to the device stack */
     Status = IoAttachDeviceToDeviceStackSafe(Fdo,
                                              PhysicalDeviceObject,
@@ -354,6 +408,10 @@ PortDispatchScsi(
     DeviceExtension = (PFDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
     DPRINT1("ExtensionType: %u\n", DeviceExtension->ExtensionType);
 
+    /* The driver above may have left its own data in there (classpnp
+       links retried IRPs through it), we keep the scatter/gather list there */
+    Irp->Tail.Overlay.DriverContext[0] = NULL;
+
     switch (DeviceExtension->ExtensionType)
     {
         case FdoExtension:
@@ -799,21 +857,22 @@ StorPortGetPhysicalAddress(
     STOR_PHYSICAL_ADDRESS PhysicalAddress;
     ULONG_PTR Offset;
 
-    DPRINT1("StorPortGetPhysicalAddress(%p %p %p %p)\n",
-            HwDeviceExtension, Srb, VirtualAddress, Length);
+    /* Miniports call this for every request, keep it quiet */
+    DPRINT("StorPortGetPhysicalAddress(%p %p %p %p)\n",
+           HwDeviceExtension, Srb, VirtualAddress, Length);
 
     /* Get the miniport extension */
     MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
                                           MINIPORT_DEVICE_EXTENSION,
                                           HwDeviceExtension);
-    DPRINT1("HwDeviceExtension %p  MiniportExtension %p\n",
-            HwDeviceExtension, MiniportExtension);
+    DPRINT("HwDeviceExtension %p  MiniportExtension %p\n",
+           HwDeviceExtension, MiniportExtension);
 
     DeviceExtension = MiniportExtension->Miniport->DeviceExtension;
 
     /* Inside of the uncached extension? */
     if (((ULONG_PTR)VirtualAddress >= (ULONG_PTR)DeviceExtension->UncachedExtensionVirtualBase) &&
-        ((ULONG_PTR)VirtualAddress <= (ULONG_PTR)DeviceExtension->UncachedExtensionVirtualBase + DeviceExtension->UncachedExtensionSize))
+        ((ULONG_PTR)VirtualAddress < (ULONG_PTR)DeviceExtension->UncachedExtensionVirtualBase + DeviceExtension->UncachedExtensionSize))
     {
         Offset = (ULONG_PTR)VirtualAddress - (ULONG_PTR)DeviceExtension->UncachedExtensionVirtualBase;
 
@@ -823,22 +882,16 @@ StorPortGetPhysicalAddress(
         return PhysicalAddress;
     }
 
-    // FIXME
-
-
+    /* Anything else is only known to be contiguous up to the end of its page */
     PhysicalAddress = MmGetPhysicalAddress(VirtualAddress);
-    *Length = 1;
-//    UNIMPLEMENTED;
-
-//    *Length = 0;
-//    PhysicalAddress.QuadPart = (LONGLONG)0;
+    *Length = PAGE_SIZE - BYTE_OFFSET(VirtualAddress);
 
     return PhysicalAddress;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 PSTOR_SCATTER_GATHER_LIST
@@ -847,9 +900,99 @@ StorPortGetScatterGatherList(
     _In_ PVOID DeviceExtension,
     _In_ PSCSI_REQUEST_BLOCK Srb)
 {
-    DPRINT1("StorPortGetScatterGatherList()\n");
-    UNIMPLEMENTED;
-    return NULL;
+    PSTOR_SCATTER_GATHER_LIST ScatterGatherList;
+    PSTOR_SCATTER_GATHER_ELEMENT Element;
+    PHYSICAL_ADDRESS PhysicalAddress;
+    PPFN_NUMBER PfnArray = NULL;
+    PCHAR VirtualAddress;
+    ULONG PageCount, PageIndex, Length, ElementLength;
+    PIRP Irp;
+    PMDL Mdl;
+
+    DPRINT("StorPortGetScatterGatherList(%p %p)\n",
+           DeviceExtension, Srb);
+
+    if ((Srb->DataBuffer == NULL) || (Srb->DataTransferLength == 0))
+        return NULL;
+
+    /* The list lives until the request completes, it hangs off the IRP
+       (PortDispatchScsi cleared the slot when the IRP came in) */
+    Irp = (PIRP)Srb->OriginalRequest;
+    if (Irp == NULL)
+    {
+        DPRINT1("Srb %p has no IRP\n", Srb);
+        return NULL;
+    }
+
+    /* Return the list we built already if the miniport asks twice */
+    ScatterGatherList = Irp->Tail.Overlay.DriverContext[0];
+    if (ScatterGatherList != NULL)
+        return ScatterGatherList;
+
+    PageCount = ADDRESS_AND_SIZE_TO_SPAN_PAGES(Srb->DataBuffer, Srb->DataTransferLength);
+
+    ScatterGatherList = ExAllocatePoolWithTag(NonPagedPool,
+                                              sizeof(STOR_SCATTER_GATHER_LIST) +
+                                              PageCount * sizeof(STOR_SCATTER_GATHER_ELEMENT),
+                                              TAG_SG_LIST);
+    if (ScatterGatherList == NULL)
+        return NULL;
+
+    ScatterGatherList->NumberOfElements = 0;
+    ScatterGatherList->Reserved = 0;
+
+    /* Take the page frames from the MDL if it describes the data buffer,
+       saves a page table walk per page */
+    VirtualAddress = (PCHAR)Srb->DataBuffer;
+    PageIndex = 0;
+    Mdl = Irp->MdlAddress;
+    if ((Mdl != NULL) &&
+        (VirtualAddress >= (PCHAR)MmGetMdlVirtualAddress(Mdl)) &&
+        (VirtualAddress + Srb->DataTransferLength <= (PCHAR)MmGetMdlVirtualAddress(Mdl) + MmGetMdlByteCount(Mdl)))
+    {
+        PfnArray = MmGetMdlPfnArray(Mdl);
+        PageIndex = (ULONG)(((ULONG_PTR)PAGE_ALIGN(VirtualAddress) -
+                             (ULONG_PTR)PAGE_ALIGN(MmGetMdlVirtualAddress(Mdl))) >> PAGE_SHIFT);
+    }
+
+    Element = NULL;
+    Length = Srb->DataTransferLength;
+    while (Length > 0)
+    {
+        ElementLength = min(Length, PAGE_SIZE - BYTE_OFFSET(VirtualAddress));
+
+        if (PfnArray != NULL)
+        {
+            PhysicalAddress.QuadPart = ((LONGLONG)PfnArray[PageIndex] << PAGE_SHIFT) + BYTE_OFFSET(VirtualAddress);
+            PageIndex++;
+        }
+        else
+        {
+            PhysicalAddress = MmGetPhysicalAddress(VirtualAddress);
+        }
+
+        /* Merge physically contiguous pages into a single element */
+        if ((Element != NULL) &&
+            (Element->PhysicalAddress.QuadPart + Element->Length == PhysicalAddress.QuadPart))
+        {
+            Element->Length += ElementLength;
+        }
+        else
+        {
+            Element = &ScatterGatherList->List[ScatterGatherList->NumberOfElements];
+            Element->PhysicalAddress = PhysicalAddress;
+            Element->Length = ElementLength;
+            Element->Reserved = 0;
+            ScatterGatherList->NumberOfElements++;
+        }
+
+        VirtualAddress += ElementLength;
+        Length -= ElementLength;
+    }
+
+    Irp->Tail.Overlay.DriverContext[0] = ScatterGatherList;
+
+    return ScatterGatherList;
 }
 
 
@@ -1136,6 +1279,10 @@ StorPortNotification(
             {
                 DPRINT1("Need to complete the IRP!\n");
 
+                /* Free the scatter/gather list built for this request */
+                if (DeviceExtension != NULL)
+                    PortFreeScatterGatherList(DeviceExtension,
+                                              (PIRP)Srb->OriginalRequest);
             }
             break;
 
@@ -697,6 +697,10 @@ AhciInterruptHandler (
     {
         AhciCompleteIssuedSrb(PortExtension, (PortExtension->CommandIssuedSlots & (~outstanding)));
         PortExtension->CommandIssuedSlots &= outstanding;
+
+        // the freed slots can take whatever is waiting in the SrbQueue, and
+        // commands held back by the queued/non-queued rule may go out now
+        AhciIssuePendingSrbs(PortExtension);
     }
 
     return;
@@ -1403,6 +1407,19 @@ AhciProcessSrb (
     NT_ASSERT(SlotIndex < AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP));
     SrbExtension->SlotIndex = SlotIndex;
 
+    // FPDMA QUEUED commands carry their tag in SectorCount[7:3],
+    // we use the command slot as tag so that PxSACT maps 1:1 to PxCI
+    if (SrbExtension->Flags & ATA_FLAGS_QUEUED)
+    {
+        SrbExtension->SectorCountLow = (UCHAR)(SlotIndex << 3);
+        SrbExtension->SectorCountHigh = 0;
+        PortExtension->QueuedCommandSlots |= 1 << SlotIndex;
+    }
+    else
+    {
+        PortExtension->QueuedCommandSlots &= ~(1 << SlotIndex);
+    }
+
     // program the CFIS in the CommandTable
     CommandHeader = &PortExtension->CommandList[SlotIndex];
 
@@ -1492,7 +1509,7 @@ AhciActivatePort (
     )
 {
     AHCI_PORT_CMD cmd;
-    ULONG QueueSlots, slotToActivate, tmp;
+    ULONG QueueSlots, QueuedCommandSlots, slotToActivate;
     PAHCI_ADAPTER_EXTENSION AdapterExtension;
 
     AhciDebugPrint("AhciActivatePort()\n");
@@ -1514,22 +1531,47 @@ AhciActivatePort (
         return;
     }
 
-    // get the lowest set bit
-    tmp = QueueSlots & (QueueSlots - 1);
+    // Native queued and non-queued commands must not be outstanding on the
+    // device at the same time. A non-queued command waits for the queued ones
+    // to drain (which also keeps a stream of queued commands from starving it),
+    // and queued commands wait for a running non-queued command.
+    QueuedCommandSlots = PortExtension->QueuedCommandSlots;
 
-    if (tmp == 0)
-        slotToActivate = QueueSlots;
+    if ((QueueSlots & ~QueuedCommandSlots) != 0)
+    {
+        if ((PortExtension->CommandIssuedSlots & QueuedCommandSlots) != 0)
+        {
+            return;
+        }
+
+        // the HBA processes non-queued commands one after another on its own
+        slotToActivate = QueueSlots & ~QueuedCommandSlots;
+    }
     else
-        slotToActivate = (QueueSlots & (~tmp));
+    {
+        if ((PortExtension->CommandIssuedSlots & ~QueuedCommandSlots) != 0)
+        {
+            return;
+        }
 
-    // mark that bit off in QueueSlots
+        slotToActivate = QueueSlots;
+    }
+
+    // mark those bits off in QueueSlots
     // so we can know we it is really needed to activate port or not
     PortExtension->QueueSlots &= ~slotToActivate;
     // mark this CommandIssuedSlots
     // to validate in completeIssuedCommand
     PortExtension->CommandIssuedSlots |= slotToActivate;
 
-    // tell the HBA to issue this Command Slot to the given port
+    // section 3.3.13
+    // PxSACT has to be set for a queued command before its PxCI bit
+    if ((slotToActivate & QueuedCommandSlots) != 0)
+    {
+        StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->SACT, slotToActivate & QueuedCommandSlots);
+    }
+
+    // tell the HBA to issue these Command Slots to the given port
     StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->CI, slotToActivate);
 
     return;
@@ -1540,51 +1582,32 @@ AhciActivatePort (
 #endif
 
 /**
- * @name AhciProcessIO
+ * @name AhciIssuePendingSrbs
  * @implemented
  *
- * Acquire Exclusive lock to port, populate pending commands to command List
- * program controller's port to process new commands in command list.
+ * Populate free command slots with pending Srbs and
+ * program controller's port to process them. Caller holds the InterruptLock.
  *
- * @param AdapterExtension
- * @param PathId
- * @param Srb
+ * @param PortExtension
  *
  */
 VOID
-AhciProcessIO (
-    __in PAHCI_ADAPTER_EXTENSION AdapterExtension,
-    __in UCHAR PathId,
-    __in PSCSI_REQUEST_BLOCK Srb
+AhciIssuePendingSrbs (
+    __in PAHCI_PORT_EXTENSION PortExtension
     )
 {
     PSCSI_REQUEST_BLOCK tmpSrb;
-    STOR_LOCK_HANDLE lockhandle = {0};
-    PAHCI_PORT_EXTENSION PortExtension;
     ULONG commandSlotMask, occupiedSlots, slotIndex, NCS;
 
-    AhciDebugPrint("AhciProcessIO()\n");
-    AhciDebugPrint("\tPathId: %d\n", PathId);
-
-    PortExtension = &AdapterExtension->PortExtension[PathId];
-
-    NT_ASSERT(PathId < AdapterExtension->PortCount);
-
-    // Acquire Lock
-    StorPortAcquireSpinLock(AdapterExtension, InterruptLock, NULL, &lockhandle);
-
-    // add Srb to queue
-    AddQueue(&PortExtension->SrbQueue, Srb);
+    AhciDebugPrint("AhciIssuePendingSrbs()\n");
 
     if (PortExtension->DeviceParams.IsActive == FALSE)
     {
-        // Release Lock
-        StorPortReleaseSpinLock(AdapterExtension, &lockhandle);
         return; // we should wait for device to get active
     }
 
     occupiedSlots = (PortExtension->QueueSlots | PortExtension->CommandIssuedSlots); // Busy command slots for given port
-    NCS = AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP);
+    NCS = min(AHCI_Global_Port_CAP_NCS(PortExtension->AdapterExtension->CAP), PortExtension->MaxPortQueueDepth);
     commandSlotMask = (1 << NCS) - 1; // available slots mask
 
     commandSlotMask = (commandSlotMask & ~occupiedSlots);
@@ -1593,30 +1616,67 @@ AhciProcessIO (
         // iterate over HBA port slots
         for (slotIndex = 0; slotIndex < NCS; slotIndex++)
         {
-            // find first free slot
-            if ((commandSlotMask & (1 << slotIndex)) != 0)
+            // skip busy slots, with several commands in flight
+            // they do not complete in slot order
+            if ((commandSlotMask & (1 << slotIndex)) == 0)
             {
-                tmpSrb = RemoveQueue(&PortExtension->SrbQueue);
-                if (tmpSrb != NULL)
-                {
-                    NT_ASSERT(tmpSrb->PathId == PathId);
-                    AhciProcessSrb(PortExtension, tmpSrb, slotIndex);
-                }
-                else
-                {
-                    break;
-                }
+                continue;
             }
-            else
+
+            tmpSrb = RemoveQueue(&PortExtension->SrbQueue);
+            if (tmpSrb == NULL)
             {
                 break;
             }
+
+            NT_ASSERT(tmpSrb->PathId == PortExtension->PortNumber);
+            AhciProcessSrb(PortExtension, tmpSrb, slotIndex);
         }
     }
 
     // program HBA port
     AhciActivatePort(PortExtension);
 
+    return;
+}// -- AhciIssuePendingSrbs();
+
+/**
+ * @name AhciProcessIO
+ * @implemented
+ *
+ * Acquire Exclusive lock to port, populate pending commands to command List
+ * program controller's port to process new commands in command list.
+ *
+ * @param AdapterExtension
+ * @param PathId
+ * @param Srb
+ *
+ */
+VOID
+AhciProcessIO (
+    __in PAHCI_ADAPTER_EXTENSION AdapterExtension,
+    __in UCHAR PathId,
+    __in PSCSI_REQUEST_BLOCK Srb
+    )
+{
+    STOR_LOCK_HANDLE lockhandle = {0};
+    PAHCI_PORT_EXTENSION PortExtension;
+
+    AhciDebugPrint("AhciProcessIO()\n");
+    AhciDebugPrint("\tPathId: %d\n", PathId);
+
+    PortExtension = &AdapterExtension->PortExtension[PathId];
+
+    NT_ASSERT(PathId < AdapterExtension->PortCount);
+
+    // Acquire Lock
+    StorPortAcquireSpinLock(AdapterExtension, InterruptLock, NULL, &lockhandle);
+
+    // add Srb to queue
+    AddQueue(&PortExtension->SrbQueue, Srb);
+
+    AhciIssuePendingSrbs(PortExtension);
+
     // Release Lock
     StorPortReleaseSpinLock(AdapterExtension, &lockhandle);
 
@@ -1735,6 +1795,17 @@ InquiryCompletion (
             PortExtension->DeviceParams.Lba48BitMode = 1;
         }
 
+        // FPDMA QUEUED commands are 48-bit only, QueueDepth is reported 0 based
+        if (IsAdapterCAPSNCQ(AdapterExtension->CAP) &&
+            PortExtension->DeviceParams.Lba48BitMode &&
+            (IdentifyDeviceData->ReservedWords76[0] & IDENTIFY_SATA_CAPABILITY_NCQ))
+        {
+            PortExtension->DeviceParams.NativeCommandQueuing = 1;
+            PortExtension->MaxPortQueueDepth = min(PortExtension->MaxPortQueueDepth,
+                                                   (ULONG)IdentifyDeviceData->QueueDepth + 1);
+            AhciDebugPrint("\tNCQ, queue depth %d\n", PortExtension->MaxPortQueueDepth);
+        }
+
         PortExtension->DeviceParams.AccessType = DIRECT_ACCESS_DEVICE;
 
         /* Device max address lba */
@@ -1798,7 +1869,7 @@ InquiryCompletion (
     // prepare data to send
     InquiryData->Versions = 2;
     InquiryData->Wide32Bit = 1;
-    InquiryData->CommandQueue = 0; // NCQ not supported
+    InquiryData->CommandQueue = PortExtension->DeviceParams.NativeCommandQueuing;
     InquiryData->ResponseDataFormat = 0x2;
     InquiryData->DeviceTypeModifier = 0;
     InquiryData->DeviceTypeQualifier = DEVICE_CONNECTED;
@@ -1820,7 +1891,7 @@ InquiryCompletion (
                                          Srb->PathId,
                                          Srb->TargetId,
                                          Srb->Lun,
-                                         AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP));
+                                         PortExtension->MaxPortQueueDepth);
 
     NT_ASSERT(status == TRUE);
     return;
@@ -2074,6 +2145,17 @@ DeviceRequestReadWrite (
     SrbExtension->SectorCountLow = (SectorCount >> 0) & 0xFF;
     SrbExtension->SectorCountHigh = (SectorCount >> 8) & 0xFF;
 
+    if (PortExtension->DeviceParams.NativeCommandQueuing)
+    {
+        // FPDMA QUEUED takes the sector count in Features,
+        // SectorCount gets the tag once AhciProcessSrb picks a slot
+        SrbExtension->Flags |= ATA_FLAGS_QUEUED;
+        SrbExtension->CommandReg = IsReading ? IDE_COMMAND_READ_FPDMA_QUEUED : IDE_COMMAND_WRITE_FPDMA_QUEUED;
+        SrbExtension->Device = IDE_LBA_MODE;
+        SrbExtension->FeaturesLow = SrbExtension->SectorCountLow;
+        SrbExtension->FeaturesHigh = SrbExtension->SectorCountHigh;
+    }
+
     NT_ASSERT(SectorCount < 0x100);
 
     SrbExtension->pSgl = (PLOCAL_SCATTER_GATHER_LIST)StorPortGetScatterGatherList(AdapterExtension, Srb);
@@ -33,6 +33,7 @@
 
 // section 3.1.2
 #define AHCI_Global_HBA_CAP_S64A            (1 << 31)
+#define AHCI_Global_HBA_CAP_SNCQ            (1 << 30)
 
 // FIS Types : http://wiki.osdev.org/AHCI
 #define FIS_TYPE_REG_H2D        0x27 // Register FIS - host to device
@@ -71,11 +72,20 @@
 #define ATA_FLAGS_DATA_OUT                  (1 << 2)
 #define ATA_FLAGS_48BIT_COMMAND             (1 << 3)
 #define ATA_FLAGS_USE_DMA                   (1 << 4)
+#define ATA_FLAGS_QUEUED                    (1 << 5) // native command queuing, tag goes in SectorCount
+
+// Native Command Queuing
+#define IDE_COMMAND_READ_FPDMA_QUEUED       0x60
+#define IDE_COMMAND_WRITE_FPDMA_QUEUED      0x61
+
+// IDENTIFY DEVICE word 76, Serial ATA capabilities
+#define IDENTIFY_SATA_CAPABILITY_NCQ        (1 << 8)
 
 #define IsAtaCommand(AtaFunction)           (AtaFunction & ATA_FUNCTION_ATA_COMMAND)
 #define IsAtapiCommand(AtaFunction)         (AtaFunction & ATA_FUNCTION_ATAPI_COMMAND)
 #define IsDataTransferNeeded(SrbExtension)  (SrbExtension->Flags & (ATA_FLAGS_DATA_IN | ATA_FLAGS_DATA_OUT))
 #define IsAdapterCAPS64(CAP)                (CAP & AHCI_Global_HBA_CAP_S64A)
+#define IsAdapterCAPSNCQ(CAP)               (CAP & AHCI_Global_HBA_CAP_SNCQ)
 
 // 3.1.1 NCS = CAP[12:08] -> Align
 #define AHCI_Global_Port_CAP_NCS(x)         (((x) & 0xF00) >> 8)
@@ -464,6 +474,7 @@ typedef struct _AHCI_PORT_EXTENSION
     ULONG PortNumber;
     ULONG QueueSlots;                                   // slots which we have already assigned task (Slot)
     ULONG CommandIssuedSlots;                           // slots which has been programmed
+    ULONG QueuedCommandSlots;                           // slots holding native queued (FPDMA) commands
     ULONG MaxPortQueueDepth;
 
     struct
@@ -473,6 +484,7 @@ typedef struct _AHCI_PORT_EXTENSION
         UCHAR AccessType;
         UCHAR DeviceType;
         UCHAR IsActive;
+        UCHAR NativeCommandQueuing;
         LARGE_INTEGER MaxLba;
         ULONG BytesPerLogicalSector;
         ULONG BytesPerPhysicalSector;
@@ -576,6 +588,11 @@ AhciProcessIO (
     __in PSCSI_REQUEST_BLOCK Srb
     );
 
+VOID
+AhciIssuePendingSrbs (
+    __in PAHCI_PORT_EXTENSION PortExtension
+    );
+
 BOOLEAN
 AhciAdapterReset (
     __in PAHCI_ADAPTER_EXTENSION AdapterExtension
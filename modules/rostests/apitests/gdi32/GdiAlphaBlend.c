@@ -0,0 +1,226 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Test for GdiAlphaBlend on 32bpp DIB sections
+ */
+
+#include "precomp.h"
+
+#define TEST_WIDTH      37      /* Not a multiple of 4, so partial vectors get used too */
+#define TEST_HEIGHT     5
+#define BENCH_SIZE      256
+#define BENCH_LOOPS     100
+
+static ULONG RandomSeed = 0x5EED;
+
+static
+ULONG
+RandomValue(void)
+{
+    RandomSeed = RandomSeed * 1103515245 + 12345;
+    return RandomSeed >> 8;
+}
+
+static
+UCHAR
+Clamp8(ULONG Value)
+{
+    return (Value > 255) ? 255 : (UCHAR)Value;
+}
+
+/* Same arithmetic as the portable loop in win32k's DIB_32BPP_AlphaBlend */
+static
+ULONG
+BlendPixel(ULONG Dst, ULONG Src, BLENDFUNCTION BlendFunc)
+{
+    ULONG SrcChannel[4], DstChannel[4];
+    ULONG Alpha, Result = 0;
+    INT i;
+
+    for (i = 0; i < 4; i++)
+    {
+        SrcChannel[i] = (((Src >> (i * 8)) & 0xFF) * BlendFunc.SourceConstantAlpha) / 255;
+        DstChannel[i] = (Dst >> (i * 8)) & 0xFF;
+    }
+
+    Alpha = (BlendFunc.AlphaFormat & AC_SRC_ALPHA) ? SrcChannel[3] : BlendFunc.SourceConstantAlpha;
+
+    for (i = 0; i < 4; i++)
+        Result |= (ULONG)Clamp8((DstChannel[i] * (255 - Alpha)) / 255 + SrcChannel[i]) << (i * 8);
+
+    return Result;
+}
+
+static
+HBITMAP
+CreateDIB32(HDC hdc, INT Width, INT Height, PULONG *Bits)
+{
+    BITMAPINFO bmi;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = Width;
+    bmi.bmiHeader.biHeight = -Height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    return CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (PVOID*)Bits, NULL, 0);
+}
+
+static
+void
+Test_Conformance(HDC hdcDst, PULONG DstBits, HDC hdcSrc, PULONG SrcBits)
+{
+    static const BYTE ConstAlpha[] = { 0, 1, 127, 128, 254, 255 };
+    ULONG Expected[TEST_WIDTH * TEST_HEIGHT];
+    BLENDFUNCTION BlendFunc = { AC_SRC_OVER, 0, 0, 0 };
+    UINT Format, a, i;
+    ULONG Mismatches;
+    INT Diff, c;
+    BOOL ret;
+
+    for (Format = 0; Format < 2; Format++)
+    {
+        for (a = 0; a < _countof(ConstAlpha); a++)
+        {
+            BlendFunc.SourceConstantAlpha = ConstAlpha[a];
+            BlendFunc.AlphaFormat = Format ? AC_SRC_ALPHA : 0;
+
+            for (i = 0; i < TEST_WIDTH * TEST_HEIGHT; i++)
+            {
+                SrcBits[i] = RandomValue() | (RandomValue() << 16);
+                DstBits[i] = RandomValue() | (RandomValue() << 16);
+
+                /* Make sure the fully transparent and opaque cases show up */
+                if (i % 7 == 0)
+                    SrcBits[i] &= 0x00FFFFFF;
+                else if (i % 7 == 1)
+                    SrcBits[i] |= 0xFF000000;
+
+                /* AC_SRC_ALPHA takes premultiplied sources */
+                if (Format)
+                {
+                    ULONG SrcAlpha = SrcBits[i] >> 24;
+
+                    SrcBits[i] = (SrcAlpha << 24) |
+                                 ((((SrcBits[i] >> 16) & 0xFF) * SrcAlpha / 255) << 16) |
+                                 ((((SrcBits[i] >> 8) & 0xFF) * SrcAlpha / 255) << 8) |
+                                 ((SrcBits[i] & 0xFF) * SrcAlpha / 255);
+                }
+
+                Expected[i] = BlendPixel(DstBits[i], SrcBits[i], BlendFunc);
+            }
+
+            ret = GdiAlphaBlend(hdcDst, 0, 0, TEST_WIDTH, TEST_HEIGHT,
+                                hdcSrc, 0, 0, TEST_WIDTH, TEST_HEIGHT, BlendFunc);
+            ok(ret == TRUE, "GdiAlphaBlend failed for alpha %u, format %u\n", ConstAlpha[a], Format);
+            GdiFlush();
+
+            /* Windows rounds a little differently, so allow one step per channel */
+            Mismatches = 0;
+            for (i = 0; i < TEST_WIDTH * TEST_HEIGHT; i++)
+            {
+                for (c = 0; c < 32; c += 8)
+                {
+                    Diff = (INT)((DstBits[i] >> c) & 0xFF) - (INT)((Expected[i] >> c) & 0xFF);
+                    if (Diff > 1 || Diff < -1)
+                    {
+                        if (Mismatches++ < 5)
+                            ok(0, "Alpha %u, format %u, pixel %u: got 0x%08lx, expected 0x%08lx\n",
+                               ConstAlpha[a], Format, i, DstBits[i], Expected[i]);
+                        break;
+                    }
+                }
+            }
+            ok(Mismatches == 0, "Alpha %u, format %u: %lu pixels differ\n", ConstAlpha[a], Format, Mismatches);
+        }
+    }
+}
+
+static
+void
+Test_Throughput(void)
+{
+    BLENDFUNCTION BlendFunc = { AC_SRC_OVER, 0, 128, AC_SRC_ALPHA };
+    LARGE_INTEGER Frequency, Start, End;
+    HDC hdcDst, hdcSrc;
+    HBITMAP hbmDst, hbmSrc;
+    PULONG DstBits, SrcBits;
+    ULONG i;
+
+    hdcDst = CreateCompatibleDC(NULL);
+    hdcSrc = CreateCompatibleDC(NULL);
+    hbmDst = CreateDIB32(hdcDst, BENCH_SIZE, BENCH_SIZE, &DstBits);
+    hbmSrc = CreateDIB32(hdcSrc, BENCH_SIZE, BENCH_SIZE, &SrcBits);
+    if (!hbmDst || !hbmSrc)
+    {
+        skip("Failed to create the bitmaps\n");
+        goto Cleanup;
+    }
+    SelectObject(hdcDst, hbmDst);
+    SelectObject(hdcSrc, hbmSrc);
+
+    for (i = 0; i < BENCH_SIZE * BENCH_SIZE; i++)
+    {
+        SrcBits[i] = 0x80404040;
+        DstBits[i] = RandomValue();
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+        GdiAlphaBlend(hdcDst, 0, 0, BENCH_SIZE, BENCH_SIZE, hdcSrc, 0, 0, BENCH_SIZE, BENCH_SIZE, BlendFunc);
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+    trace("GdiAlphaBlend: %lu blits of %ux%u in %lu ms\n", (ULONG)BENCH_LOOPS, BENCH_SIZE, BENCH_SIZE,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+
+    /* The same work done by the portable loop, for comparison */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS * BENCH_SIZE * BENCH_SIZE; i++)
+        DstBits[i % (BENCH_SIZE * BENCH_SIZE)] = BlendPixel(DstBits[i % (BENCH_SIZE * BENCH_SIZE)],
+                                                            SrcBits[i % (BENCH_SIZE * BENCH_SIZE)],
+                                                            BlendFunc);
+    QueryPerformanceCounter(&End);
+    trace("Reference loop: %lu blits of %ux%u in %lu ms\n", (ULONG)BENCH_LOOPS, BENCH_SIZE, BENCH_SIZE,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+
+Cleanup:
+    if (hbmDst) DeleteObject(hbmDst);
+    if (hbmSrc) DeleteObject(hbmSrc);
+    DeleteDC(hdcDst);
+    DeleteDC(hdcSrc);
+}
+
+START_TEST(GdiAlphaBlend)
+{
+    HDC hdcDst, hdcSrc;
+    HBITMAP hbmDst, hbmSrc;
+    PULONG DstBits, SrcBits;
+
+    hdcDst = CreateCompatibleDC(NULL);
+    hdcSrc = CreateCompatibleDC(NULL);
+    ok(hdcDst != NULL && hdcSrc != NULL, "CreateCompatibleDC failed\n");
+
+    hbmDst = CreateDIB32(hdcDst, TEST_WIDTH, TEST_HEIGHT, &DstBits);
+    hbmSrc = CreateDIB32(hdcSrc, TEST_WIDTH, TEST_HEIGHT, &SrcBits);
+    if (!hbmDst || !hbmSrc)
+    {
+        skip("Failed to create the bitmaps\n");
+    }
+    else
+    {
+        SelectObject(hdcDst, hbmDst);
+        SelectObject(hdcSrc, hbmSrc);
+        Test_Conformance(hdcDst, DstBits, hdcSrc, SrcBits);
+    }
+
+    if (hbmDst) DeleteObject(hbmDst);
+    if (hbmSrc) DeleteObject(hbmSrc);
+    DeleteDC(hdcDst);
+    DeleteDC(hdcSrc);
+
+    Test_Throughput();
+}
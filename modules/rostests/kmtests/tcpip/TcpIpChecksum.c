@@ -0,0 +1,228 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Kernel-Mode Test Suite for the tcpip checksum routines
+ */
+
+#include <kmt_test.h>
+
+/* From the tcpip driver's checksum.h, which needs most of the driver's headers */
+ULONG ChecksumFold(ULONG Sum);
+ULONG ChecksumCompute(PVOID Data, unsigned int Count, ULONG Seed);
+ULONG UDPv4ChecksumCalculate(PVOID IPHeader, PUCHAR PacketBuffer, ULONG DataLength);
+
+/* Same layout as the driver's IPv4_HEADER */
+typedef struct _TEST_IPV4_HEADER
+{
+    UCHAR VerIHL;
+    UCHAR Tos;
+    USHORT TotalLength;
+    USHORT Id;
+    USHORT FlagsFragOfs;
+    UCHAR Ttl;
+    UCHAR Protocol;
+    USHORT Checksum;
+    ULONG SrcAddr;
+    ULONG DstAddr;
+} TEST_IPV4_HEADER, *PTEST_IPV4_HEADER;
+
+#define TEST_BUFFER_SIZE        2048
+#define TEST_MAX_LENGTH         1600
+#define TEST_ITERATIONS         20000
+#define TEST_BENCH_LENGTH       1500
+#define TEST_BENCH_ITERATIONS   100000
+#define TEST_IPPROTO_UDP        17
+
+/* The routines as they were before they summed wider words */
+static
+ULONG
+RefChecksumCompute(
+    PVOID Data,
+    unsigned int Count,
+    ULONG Seed)
+{
+    ULONG Sum = Seed;
+
+    while (Count > 1)
+    {
+        Sum += *(PUSHORT)Data;
+        Count -= 2;
+        Data = (PVOID)((ULONG_PTR)Data + 2);
+    }
+
+    if (Count > 0)
+    {
+        Sum += *(PUCHAR)Data;
+    }
+
+    return Sum;
+}
+
+static
+ULONG
+RefUDPv4ChecksumCalculate(
+    PTEST_IPV4_HEADER IPHeader,
+    PUCHAR PacketBuffer,
+    ULONG DataLength)
+{
+    ULONG Sum = 0;
+    USHORT TmpSum;
+    ULONG i;
+    BOOLEAN Pad;
+
+    Pad = (DataLength & 1);
+    if (Pad)
+        DataLength++;
+
+    for (i = 0; i < DataLength; i += 2)
+    {
+        TmpSum = ((PacketBuffer[i] << 8) & 0xFF00) +
+                 ((Pad && i == DataLength - 2) ? 0 : (PacketBuffer[i + 1] & 0x00FF));
+        Sum += TmpSum;
+    }
+
+    for (i = 0; i < sizeof(ULONG); i += 2)
+    {
+        TmpSum = ((((PUCHAR)&IPHeader->SrcAddr)[i] << 8) & 0xFF00) +
+                 (((PUCHAR)&IPHeader->SrcAddr)[i + 1] & 0x00FF);
+        Sum += TmpSum;
+    }
+
+    for (i = 0; i < sizeof(ULONG); i += 2)
+    {
+        TmpSum = ((((PUCHAR)&IPHeader->DstAddr)[i] << 8) & 0xFF00) +
+                 (((PUCHAR)&IPHeader->DstAddr)[i + 1] & 0x00FF);
+        Sum += TmpSum;
+    }
+
+    Sum += TEST_IPPROTO_UDP + (DataLength - (Pad ? 1 : 0));
+
+    return ~ChecksumFold(Sum);
+}
+
+static
+VOID
+FillRandom(
+    PUCHAR Buffer,
+    ULONG Length,
+    PULONG RandSeed)
+{
+    ULONG i;
+
+    for (i = 0; i < Length; i++)
+        Buffer[i] = (UCHAR)RtlRandomEx(RandSeed);
+}
+
+static
+VOID
+TestChecksumCompute(
+    PUCHAR Buffer,
+    PULONG RandSeed)
+{
+    ULONG i, Offset, Length, Seed;
+    ULONG Sum, RefSum;
+    ULONG Failures = 0;
+
+    /* Edge values: all zeroes and all ones */
+    RtlZeroMemory(Buffer, TEST_BUFFER_SIZE);
+    ok_eq_hex(ChecksumFold(ChecksumCompute(Buffer, TEST_MAX_LENGTH, 0)), 0UL);
+    RtlFillMemory(Buffer, TEST_BUFFER_SIZE, 0xFF);
+    ok_eq_hex(ChecksumFold(ChecksumCompute(Buffer, TEST_MAX_LENGTH, 0)), 0xFFFFUL);
+    ok_eq_hex(ChecksumFold(ChecksumCompute(Buffer, 1, 0)), 0xFFUL);
+
+    for (i = 0; i < TEST_ITERATIONS; i++)
+    {
+        Offset = RtlRandomEx(RandSeed) % 8;
+        Length = RtlRandomEx(RandSeed) % (TEST_MAX_LENGTH + 1);
+        Seed = RtlRandomEx(RandSeed) & 0xFFFF;
+        FillRandom(Buffer + Offset, Length, RandSeed);
+
+        Sum = ChecksumFold(ChecksumCompute(Buffer + Offset, Length, Seed));
+        RefSum = ChecksumFold(RefChecksumCompute(Buffer + Offset, Length, Seed));
+        if (Sum != RefSum)
+        {
+            if (Failures++ < 10)
+                ok(0, "Offset %lu, length %lu, seed 0x%lx: 0x%lx, expected 0x%lx\n",
+                   Offset, Length, Seed, Sum, RefSum);
+        }
+    }
+    ok_eq_ulong(Failures, 0UL);
+}
+
+static
+VOID
+TestUDPv4Checksum(
+    PUCHAR Buffer,
+    PULONG RandSeed)
+{
+    TEST_IPV4_HEADER Header;
+    ULONG i, Offset, Length;
+    ULONG Sum, RefSum;
+    ULONG Failures = 0;
+
+    RtlZeroMemory(&Header, sizeof(Header));
+
+    for (i = 0; i < TEST_ITERATIONS; i++)
+    {
+        Offset = RtlRandomEx(RandSeed) % 8;
+        Length = RtlRandomEx(RandSeed) % (TEST_MAX_LENGTH + 1);
+        Header.SrcAddr = RtlRandomEx(RandSeed);
+        Header.DstAddr = RtlRandomEx(RandSeed);
+        FillRandom(Buffer + Offset, Length, RandSeed);
+
+        /* The receive path compares the whole value, not just the low 16 bits */
+        Sum = UDPv4ChecksumCalculate(&Header, Buffer + Offset, Length);
+        RefSum = RefUDPv4ChecksumCalculate(&Header, Buffer + Offset, Length);
+        if (Sum != RefSum)
+        {
+            if (Failures++ < 10)
+                ok(0, "Offset %lu, length %lu: 0x%lx, expected 0x%lx\n",
+                   Offset, Length, Sum, RefSum);
+        }
+    }
+    ok_eq_ulong(Failures, 0UL);
+}
+
+static
+VOID
+BenchChecksumCompute(
+    PUCHAR Buffer)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Time, RefTime;
+    ULONG i, Sum = 0, RefSum = 0;
+
+    Start = KeQueryPerformanceCounter(&Frequency);
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++)
+        Sum += ChecksumCompute(Buffer, TEST_BENCH_LENGTH, 0);
+    End = KeQueryPerformanceCounter(NULL);
+    Time = End.QuadPart - Start.QuadPart;
+
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++)
+        RefSum += RefChecksumCompute(Buffer, TEST_BENCH_LENGTH, 0);
+    End = KeQueryPerformanceCounter(NULL);
+    RefTime = End.QuadPart - Start.QuadPart;
+
+    /* Use the sums so the loops aren't optimized away */
+    trace("%lu x %lu bytes: %I64u ticks, previously %I64u ticks, at %I64u ticks/s (0x%lx/0x%lx)\n",
+          TEST_BENCH_ITERATIONS, TEST_BENCH_LENGTH, Time, RefTime, Frequency.QuadPart, Sum, RefSum);
+}
+
+START_TEST(TcpIpChecksum)
+{
+    PUCHAR Buffer;
+    ULONG RandSeed = 0x5EED;
+
+    Buffer = ExAllocatePoolWithTag(NonPagedPool, TEST_BUFFER_SIZE, 'tseT');
+    if (skip(Buffer != NULL, "Out of memory\n"))
+        return;
+
+    TestChecksumCompute(Buffer, &RandSeed);
+    TestUDPv4Checksum(Buffer, &RandSeed);
+
+    FillRandom(Buffer, TEST_BENCH_LENGTH, &RandSeed);
+    BenchChecksumCompute(Buffer);
+
+    ExFreePoolWithTag(Buffer, 'tseT');
+}
@@ -35,25 +35,44 @@ ULONG ChecksumCompute(
  *     Count = Number of bytes in buffer
  *     Seed  = Previously calculated checksum (if any)
  * RETURNS:
- *     Checksum of buffer
+ *     Checksum of buffer (not folded)
  */
 {
-  register ULONG Sum = Seed;
+#ifdef _M_IX86
+  /* The assembly version adds 32 bits at a time with carry */
+  return csum_partial(Data, Count, Seed);
+#else
+  ULONGLONG Sum = Seed;
+  PUCHAR Buffer = Data;
+
+  /* Add 32 bits at a time, the 64-bit sum cannot overflow for any
+     buffer we can get here and folds to the same 16-bit result */
+  while (Count >= 4)
+    {
+      Sum += *(ULONG UNALIGNED *)Buffer;
+      Count -= 4;
+      Buffer += 4;
+    }
 
-  while (Count > 1)
+  if (Count >= 2)
     {
-      Sum += *(PUSHORT)Data;
+      Sum += *(USHORT UNALIGNED *)Buffer;
       Count -= 2;
-      Data = (PVOID)((ULONG_PTR) Data + 2);
+      Buffer += 2;
     }
 
   /* Add left-over byte, if any */
   if (Count > 0)
     {
-      Sum += *(PUCHAR)Data;
+      Sum += *Buffer;
     }
 
-  return Sum;
+  /* Fold the 64-bit sum to 32 bits */
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+
+  return (ULONG)Sum;
+#endif
 }
 
 ULONG
@@ -62,44 +81,21 @@ UDPv4ChecksumCalculate(
   PUCHAR PacketBuffer,
   ULONG DataLength)
 {
-  ULONG Sum = 0;
-  USHORT TmpSum;
-  ULONG i;
-  BOOLEAN Pad;
+  ULONG Sum;
 
-  /* Pad the data if needed */
-  Pad = (DataLength & 1);
-  if (Pad)
-      DataLength++;
+  /* Add the UDP header and data, then the source and destination
+     addresses. A missing byte at the end counts as zero padding. */
+  Sum = ChecksumCompute(PacketBuffer, DataLength, 0);
+  Sum = ChecksumCompute(&IPHeader->SrcAddr, sizeof(IPv4_RAW_ADDRESS), Sum);
+  Sum = ChecksumCompute(&IPHeader->DstAddr, sizeof(IPv4_RAW_ADDRESS), Sum);
 
-  /* Add from the UDP header and data */
-  for (i = 0; i < DataLength; i += 2)
-  {
-       TmpSum = ((PacketBuffer[i] << 8) & 0xFF00) +
-                ((Pad && i == DataLength - 2) ? 0 : (PacketBuffer[i+1] & 0x00FF));
-       Sum += TmpSum;
-  }
-
-  /* Add the source address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->SrcAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->SrcAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the destination address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->DstAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->DstAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
+  /* That sum is over host order words, byte swapping the folded
+     value gives the same sum over network order words */
+  Sum = WH2N((USHORT)ChecksumFold(Sum));
 
   /* Add the proto number and length */
-  Sum += IPPROTO_UDP + (DataLength - (Pad ? 1 : 0));
+  Sum += IPPROTO_UDP + DataLength;
 
   /* Fold the checksum and return the one's complement */
   return ~ChecksumFold(Sum);
 }
-
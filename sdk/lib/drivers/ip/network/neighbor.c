@@ -12,6 +12,26 @@
 
 NEIGHBOR_CACHE_TABLE NeighborCache[NB_HASHMASK + 1];
 
+static UINT NBHashAddress(
+    PIP_ADDRESS Address)
+/*
+ * FUNCTION: Computes the neighbor cache bucket of an address
+ * ARGUMENTS:
+ *     Address = Pointer to IP address
+ * RETURNS:
+ *     Index into NeighborCache
+ */
+{
+    UINT HashValue;
+
+    HashValue  = *(PULONG)&Address->Address;
+    HashValue ^= HashValue >> 16;
+    HashValue ^= HashValue >> 8;
+    HashValue ^= HashValue >> 4;
+
+    return HashValue & NB_HASHMASK;
+}
+
 VOID NBCompleteSend( PVOID Context,
 		     PNDIS_PACKET NdisPacket,
 		     NDIS_STATUS Status ) {
@@ -29,19 +49,25 @@ VOID NBSendPackets( PNEIGHBOR_CACHE_ENTRY NCE ) {
     PLIST_ENTRY PacketEntry;
     PNEIGHBOR_PACKET Packet;
     UINT HashValue;
+    KIRQL OldIrql;
 
     ASSERT(!(NCE->State & NUD_INCOMPLETE));
 
-    HashValue  = *(PULONG)(&NCE->Address.Address);
-    HashValue ^= HashValue >> 16;
-    HashValue ^= HashValue >> 8;
-    HashValue ^= HashValue >> 4;
-    HashValue &= NB_HASHMASK;
+    HashValue = NBHashAddress(&NCE->Address);
 
     /* Send any waiting packets */
-    while ((PacketEntry = ExInterlockedRemoveHeadList(&NCE->PacketQueue,
-                                              &NeighborCache[HashValue].Lock)) != NULL)
+    for (;;)
     {
+        TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
+        if (IsListEmpty(&NCE->PacketQueue))
+        {
+            TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
+            break;
+        }
+        PacketEntry = RemoveHeadList(&NCE->PacketQueue);
+        NCE->PacketCount--;
+        TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
+
 	Packet = CONTAINING_RECORD( PacketEntry, NEIGHBOR_PACKET, Next );
 
 	TI_DbgPrint
@@ -86,6 +112,8 @@ VOID NBFlushPacketQueue( PNEIGHBOR_CACHE_ENTRY NCE,
 
 	ExFreePoolWithTag( Packet, NEIGHBOR_PACKET_TAG );
     }
+
+    NCE->PacketCount = 0;
 }
 
 VOID NBTimeout(VOID)
@@ -102,6 +130,11 @@ VOID NBTimeout(VOID)
     NDIS_STATUS Status;
 
     for (i = 0; i <= NB_HASHMASK; i++) {
+        /* Most buckets are empty, don't bother locking them. An entry
+           that is being added right now is looked at next time */
+        if (NeighborCache[i].Cache == NULL)
+            continue;
+
         TcpipAcquireSpinLockAtDpcLevel(&NeighborCache[i].Lock);
 
         for (PrevNCE = &NeighborCache[i].Cache;
@@ -324,14 +357,11 @@ PNEIGHBOR_CACHE_ENTRY NBAddNeighbor(
   NCE->EventTimer = EventTimer;
   NCE->EventCount = 0;
   InitializeListHead( &NCE->PacketQueue );
+  NCE->PacketCount = 0;
 
   TI_DbgPrint(MID_TRACE,("NCE: %x\n", NCE));
 
-  HashValue = *(PULONG)&Address->Address;
-  HashValue ^= HashValue >> 16;
-  HashValue ^= HashValue >> 8;
-  HashValue ^= HashValue >> 4;
-  HashValue &= NB_HASHMASK;
+  HashValue = NBHashAddress(Address);
 
   TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
 
@@ -362,11 +392,7 @@ VOID NBUpdateNeighbor(
 
     TI_DbgPrint(DEBUG_NCACHE, ("Called. NCE (0x%X)  LinkAddress (0x%X)  State (0x%X).\n", NCE, LinkAddress, State));
 
-    HashValue  = *(PULONG)(&NCE->Address.Address);
-    HashValue ^= HashValue >> 16;
-    HashValue ^= HashValue >> 8;
-    HashValue ^= HashValue >> 4;
-    HashValue &= NB_HASHMASK;
+    HashValue = NBHashAddress(&NCE->Address);
 
     TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
 
@@ -392,11 +418,7 @@ NBResetNeighborTimeout(PIP_ADDRESS Address)
 
     TI_DbgPrint(DEBUG_NCACHE, ("Resetting NCE timout for 0x%s\n", A2S(Address)));
 
-    HashValue  = *(PULONG)(&Address->Address);
-    HashValue ^= HashValue >> 16;
-    HashValue ^= HashValue >> 8;
-    HashValue ^= HashValue >> 4;
-    HashValue &= NB_HASHMASK;
+    HashValue = NBHashAddress(Address);
 
     TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
 
@@ -436,11 +458,7 @@ PNEIGHBOR_CACHE_ENTRY NBLocateNeighbor(
 
   TI_DbgPrint(DEBUG_NCACHE, ("Called. Address (0x%X).\n", Address));
 
-  HashValue = *(PULONG)&Address->Address;
-  HashValue ^= HashValue >> 16;
-  HashValue ^= HashValue >> 8;
-  HashValue ^= HashValue >> 4;
-  HashValue &= NB_HASHMASK;
+  HashValue = NBHashAddress(Address);
 
   TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
 
@@ -553,7 +571,7 @@ BOOLEAN NBQueuePacket(
  */
 {
   KIRQL OldIrql;
-  PNEIGHBOR_PACKET Packet;
+  PNEIGHBOR_PACKET Packet, Dropped = NULL;
   UINT HashValue;
 
   TI_DbgPrint
@@ -564,23 +582,33 @@ BOOLEAN NBQueuePacket(
                                   NEIGHBOR_PACKET_TAG );
   if( !Packet ) return FALSE;
 
-  /* FIXME: Should we limit the number of queued packets? */
-
-  HashValue  = *(PULONG)(&NCE->Address.Address);
-  HashValue ^= HashValue >> 16;
-  HashValue ^= HashValue >> 8;
-  HashValue ^= HashValue >> 4;
-  HashValue &= NB_HASHMASK;
+  HashValue = NBHashAddress(&NCE->Address);
 
   TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
 
+  /* Don't let an unresolved neighbor pile up packets, drop the oldest */
+  if (NCE->PacketCount >= NB_MAX_QUEUED_PACKETS)
+  {
+      Dropped = CONTAINING_RECORD(RemoveHeadList(&NCE->PacketQueue),
+                                  NEIGHBOR_PACKET, Next);
+      NCE->PacketCount--;
+  }
+
   Packet->Complete = PacketComplete;
   Packet->Context = PacketContext;
   Packet->Packet = NdisPacket;
   InsertTailList( &NCE->PacketQueue, &Packet->Next );
+  NCE->PacketCount++;
 
   TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
 
+  if (Dropped)
+  {
+      TI_DbgPrint(MID_TRACE, ("Dropping queued packet %x\n", Dropped->Packet));
+      Dropped->Complete(Dropped->Context, Dropped->Packet, NDIS_STATUS_RESOURCES);
+      ExFreePoolWithTag(Dropped, NEIGHBOR_PACKET_TAG);
+  }
+
   if( !(NCE->State & NUD_INCOMPLETE) )
       NBSendPackets( NCE );
 
@@ -604,11 +632,7 @@ VOID NBRemoveNeighbor(
 
   TI_DbgPrint(DEBUG_NCACHE, ("Called. NCE (0x%X).\n", NCE));
 
-  HashValue  = *(PULONG)(&NCE->Address.Address);
-  HashValue ^= HashValue >> 16;
-  HashValue ^= HashValue >> 8;
-  HashValue ^= HashValue >> 4;
-  HashValue &= NB_HASHMASK;
+  HashValue = NBHashAddress(&NCE->Address);
 
   TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
 
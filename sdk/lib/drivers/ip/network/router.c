@@ -16,6 +16,21 @@
 
 LIST_ENTRY FIBListHead;
 KSPIN_LOCK FIBLock;
+ROUTE_CACHE_ENTRY RouteCache[ROUTE_CACHE_SIZE];
+
+#define ROUTE_CACHE_HASH(Address) ((ULONG)((Address) * 0x9E3779B1) >> 26)
+
+VOID RouterFlushCache(
+    VOID)
+/*
+ * FUNCTION: Forgets all routes remembered in the route cache
+ * NOTES:
+ *     The forward information base lock must be held when called
+ */
+{
+    RtlZeroMemory(RouteCache, sizeof(RouteCache));
+}
+
 
 void RouterDumpRoutes() {
     PLIST_ENTRY CurrentEntry;
@@ -69,6 +84,9 @@ VOID DestroyFIBE(
     /* Unlink the FIB entry from the list */
     RemoveEntryList(&FIBE->ListEntry);
 
+    /* The cache may still point to it */
+    RouterFlushCache();
+
     /* And free the FIB entry */
     FreeFIB(FIBE);
 }
@@ -186,6 +204,29 @@ UINT CommonPrefixLength(
 }
 
 
+BOOLEAN RouterMatchesRoute(
+    PIP_ADDRESS Destination,
+    PFIB_ENTRY FIBE)
+/*
+ * FUNCTION: Checks if a destination lies in the network of a route
+ * ARGUMENTS:
+ *     Destination = Pointer to destination address
+ *     FIBE        = Pointer to FIB entry
+ * RETURNS:
+ *     TRUE if the route can be used to reach Destination
+ */
+{
+    if (Destination->Type != FIBE->NetworkAddress.Type)
+        return FALSE;
+
+    if (Destination->Type == IP_ADDRESS_V4)
+        return ((Destination->Address.IPv4Address ^ FIBE->NetworkAddress.Address.IPv4Address) &
+                FIBE->Netmask.Address.IPv4Address) == 0;
+
+    return CommonPrefixLength(Destination, &FIBE->NetworkAddress) >= FIBE->PrefixLength;
+}
+
+
 PFIB_ENTRY RouterAddRoute(
     PIP_ADDRESS NetworkAddress,
     PIP_ADDRESS Netmask,
@@ -206,6 +247,9 @@ PFIB_ENTRY RouterAddRoute(
  *     these references
  */
 {
+    KIRQL OldIrql;
+    PLIST_ENTRY CurrentEntry;
+    PFIB_ENTRY Current;
     PFIB_ENTRY FIBE;
 
     TI_DbgPrint(DEBUG_ROUTER, ("Called. NetworkAddress (0x%X)  Netmask (0x%X) "
@@ -228,9 +272,25 @@ PFIB_ENTRY RouterAddRoute(
 		   sizeof(FIBE->Netmask) );
     FIBE->Router         = Router;
     FIBE->Metric         = Metric;
+    FIBE->PrefixLength   = AddrCountPrefixBits(Netmask);
 
-    /* Add FIB to the forward information base */
-    TcpipInterlockedInsertTailList(&FIBListHead, &FIBE->ListEntry, &FIBLock);
+    TcpipAcquireSpinLock(&FIBLock, &OldIrql);
+
+    /* Add FIB to the forward information base. The list is kept sorted
+       by decreasing prefix length, so the first route that matches a
+       destination is its longest prefix match */
+    CurrentEntry = FIBListHead.Flink;
+    while (CurrentEntry != &FIBListHead) {
+        Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, ListEntry);
+        if (Current->PrefixLength < FIBE->PrefixLength)
+            break;
+        CurrentEntry = CurrentEntry->Flink;
+    }
+    InsertTailList(CurrentEntry, &FIBE->ListEntry);
+
+    RouterFlushCache();
+
+    TcpipReleaseSpinLock(&FIBLock, OldIrql);
 
     return FIBE;
 }
@@ -245,15 +305,16 @@ PNEIGHBOR_CACHE_ENTRY RouterGetRoute(PIP_ADDRESS Destination)
  *     Pointer to NCE for router, NULL if none was found
  * NOTES:
  *     If found the NCE is referenced
+ *     Routes whose router is stale or incomplete are only used when no
+ *     other route matches
  */
 {
     KIRQL OldIrql;
     PLIST_ENTRY CurrentEntry;
-    PLIST_ENTRY NextEntry;
-    PFIB_ENTRY Current;
+    PFIB_ENTRY Current, BestFIBE = NULL, FallbackFIBE = NULL;
+    PROUTE_CACHE_ENTRY CacheEntry = NULL;
     UCHAR State;
-    UINT Length, BestLength = 0, MaskLength;
-    PNEIGHBOR_CACHE_ENTRY NCE, BestNCE = NULL;
+    PNEIGHBOR_CACHE_ENTRY BestNCE = NULL;
 
     TI_DbgPrint(DEBUG_ROUTER, ("Called. Destination (0x%X)\n", Destination));
 
@@ -261,31 +322,58 @@ PNEIGHBOR_CACHE_ENTRY RouterGetRoute(PIP_ADDRESS Destination)
 
     TcpipAcquireSpinLock(&FIBLock, &OldIrql);
 
-    CurrentEntry = FIBListHead.Flink;
-    while (CurrentEntry != &FIBListHead) {
-        NextEntry = CurrentEntry->Flink;
-	    Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, ListEntry);
+    /* Check if we recently routed to this destination */
+    if (Destination->Type == IP_ADDRESS_V4) {
+        CacheEntry = &RouteCache[ROUTE_CACHE_HASH(Destination->Address.IPv4Address)];
+        if (CacheEntry->FIBE &&
+            CacheEntry->Destination == Destination->Address.IPv4Address) {
+            State = CacheEntry->FIBE->Router->State;
+            if (!(State & NUD_STALE) && !(State & NUD_INCOMPLETE))
+                BestFIBE = CacheEntry->FIBE;
+        }
+    }
 
-        NCE   = Current->Router;
-        State = NCE->State;
+    if (!BestFIBE) {
+        CurrentEntry = FIBListHead.Flink;
+        while (CurrentEntry != &FIBListHead) {
+            Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, ListEntry);
 
-	Length = CommonPrefixLength(Destination, &Current->NetworkAddress);
-	MaskLength = AddrCountPrefixBits(&Current->Netmask);
+            if (RouterMatchesRoute(Destination, Current)) {
+                State = Current->Router->State;
 
-	TI_DbgPrint(DEBUG_ROUTER,("This-Route: %s (Sharing %d bits)\n",
-				  A2S(&NCE->Address), Length));
+                TI_DbgPrint(DEBUG_ROUTER,("This-Route: %s (Prefix %d bits)\n",
+                                          A2S(&Current->Router->Address),
+                                          Current->PrefixLength));
 
-	if(Length >= MaskLength && (Length > BestLength || !BestNCE) &&
-           ((!(State & NUD_STALE) && !(State & NUD_INCOMPLETE)) || !BestNCE)) {
-	    /* This seems to be a better router */
-	    BestNCE    = NCE;
-	    BestLength = Length;
-	    TI_DbgPrint(DEBUG_ROUTER,("Route selected\n"));
-	}
+                if (!(State & NUD_STALE) && !(State & NUD_INCOMPLETE)) {
+                    /* Longest usable prefix, we are done */
+                    BestFIBE = Current;
+                    TI_DbgPrint(DEBUG_ROUTER,("Route selected\n"));
+                    break;
+                }
 
-        CurrentEntry = NextEntry;
+                /* Remember the longest one in case nothing better shows up */
+                if (!FallbackFIBE)
+                    FallbackFIBE = Current;
+            }
+
+            CurrentEntry = CurrentEntry->Flink;
+        }
+
+        /* Only cache real longest prefix matches, a longer route that was
+           skipped may become usable again */
+        if (CacheEntry && BestFIBE && !FallbackFIBE) {
+            CacheEntry->Destination = Destination->Address.IPv4Address;
+            CacheEntry->FIBE = BestFIBE;
+        }
+
+        if (!BestFIBE)
+            BestFIBE = FallbackFIBE;
     }
 
+    if (BestFIBE)
+        BestNCE = BestFIBE->Router;
+
     TcpipReleaseSpinLock(&FIBLock, OldIrql);
 
     if( BestNCE ) {
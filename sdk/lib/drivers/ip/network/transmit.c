@@ -56,7 +56,12 @@ NTSTATUS IPSendFragment(
     TI_DbgPrint(MAX_TRACE, ("Called. NdisPacket (0x%X)  NCE (0x%X).\n", NdisPacket, NCE));
 
     TI_DbgPrint(MAX_TRACE, ("NCE->State = %d.\n", NCE->State));
-    return NBQueuePacket(NCE, NdisPacket, IPSendComplete, IFC);
+
+    /* The completion routine is not called if the packet couldn't be queued */
+    if (!NBQueuePacket(NCE, NdisPacket, IPSendComplete, IFC))
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    return STATUS_SUCCESS;
 }
 
 BOOLEAN PrepareNextFragment(
@@ -519,7 +519,7 @@ LibTCPSendCallback(void *arg)
     if (msg->Output.Send.Error == ERR_OK)
     {
         /* Queued successfully so try to send it */
-        tcp_output((PTCP_PCB)msg->Input.Send.Connection->SocketContext);
+        tcp_output(pcb);
         msg->Output.Send.Information = SendLength;
     }
     else if (msg->Output.Send.Error == ERR_MEM)
@@ -547,14 +547,20 @@ LibTCPSend(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u16_t len
         msg->Input.Send.DataLength = len;
 
         if (safe)
+        {
+            /* We're in the tcpip thread so the callback completes here */
             LibTCPSendCallback(msg);
+            ret = msg->Output.Send.Error;
+        }
         else
+        {
             tcpip_callback_with_block(LibTCPSendCallback, msg, 1);
 
-        if (WaitForEventSafely(&msg->Event))
-            ret = msg->Output.Send.Error;
-        else
-            ret = ERR_CLSD;
+            if (WaitForEventSafely(&msg->Event))
+                ret = msg->Output.Send.Error;
+            else
+                ret = ERR_CLSD;
+        }
 
         if (ret == ERR_OK)
             *sent = msg->Output.Send.Information;
@@ -23,8 +23,10 @@
  * rop codes and all depths. The drawback is that it will be relatively slow.
  * The other extreme is to write (generate) a separate Blt routine for each
  * rop code/depth combination. This will result in a extremely large amount
- * of code. So, we opt for something in between: named rops get their own
- * routine, unnamed rops are handled by a generic routine.
+ * of code. So, we opt for something in between: named rops and the most
+ * common unnamed ones get their own routine, the rest are handled by a
+ * generic routine. Before generating anything, every specialized operation
+ * is checked against its rop code, so a wrong table entry fails the build.
  * Basically, what happens is that generic code which looks like:
  *
  * for (...)
@@ -114,6 +116,23 @@
 #define ROPCODE_PATPAINT    0xfb
 #define ROPCODE_WHITENESS   0xff
 
+/* Unnamed rops that are common enough to get their own routine */
+#define ROPCODE_DPON        0x05
+#define ROPCODE_DPNA        0x0a
+#define ROPCODE_PN          0x0f
+#define ROPCODE_DSNA        0x22
+#define ROPCODE_PDNA        0x50
+#define ROPCODE_DPAN        0x5f
+#define ROPCODE_DSAN        0x77
+#define ROPCODE_DSXN        0x99
+#define ROPCODE_DPA         0xa0
+#define ROPCODE_DPNO        0xaf
+#define ROPCODE_PSDPXAX     0xb8
+#define ROPCODE_SDNO        0xdd
+#define ROPCODE_DSPDXAX     0xe2
+#define ROPCODE_PDNO        0xf5
+#define ROPCODE_DPO         0xfa
+
 #define ROPCODE_GENERIC     256 /* Special case */
 
 typedef struct _ROPINFO
@@ -154,6 +173,21 @@ FindRopInfo(unsigned RopCode)
         { ROPCODE_PATCOPY,     "PATCOPY",    "P",            0, 0, 1 },
         { ROPCODE_PATPAINT,    "PATPAINT",   "D | (~S) | P", 1, 1, 1 },
         { ROPCODE_WHITENESS,   "WHITENESS",  "0xffffffff",   0, 0, 0 },
+        { ROPCODE_DPON,        "DPon",       "~(D | P)",     1, 0, 1 },
+        { ROPCODE_DPNA,        "DPna",       "D & (~P)",     1, 0, 1 },
+        { ROPCODE_PN,          "Pn",         "~P",           0, 0, 1 },
+        { ROPCODE_DSNA,        "DSna",       "D & (~S)",     1, 1, 0 },
+        { ROPCODE_PDNA,        "PDna",       "P & (~D)",     1, 0, 1 },
+        { ROPCODE_DPAN,        "DPan",       "~(D & P)",     1, 0, 1 },
+        { ROPCODE_DSAN,        "DSan",       "~(D & S)",     1, 1, 0 },
+        { ROPCODE_DSXN,        "DSxn",       "~(D ^ S)",     1, 1, 0 },
+        { ROPCODE_DPA,         "DPa",        "D & P",        1, 0, 1 },
+        { ROPCODE_DPNO,        "DPno",       "D | (~P)",     1, 0, 1 },
+        { ROPCODE_PSDPXAX,     "PSDPxax",    "((D ^ P) & S) ^ P", 1, 1, 1 },
+        { ROPCODE_SDNO,        "SDno",       "S | (~D)",     1, 1, 0 },
+        { ROPCODE_DSPDXAX,     "DSPDxax",    "((D ^ P) & S) ^ D", 1, 1, 1 },
+        { ROPCODE_PDNO,        "PDno",       "P | (~D)",     1, 0, 1 },
+        { ROPCODE_DPO,         "DPo",        "D | P",        1, 0, 1 },
         { ROPCODE_GENERIC,     NULL,         NULL,           1, 1, 1 }
     };
     unsigned Index;
@@ -967,6 +1001,147 @@ CreateBitBlt(FILE *Out, unsigned Bpp)
     Output(Out, "}\n");
 }
 
+/*
+ * Evaluate an Operation string on the rop truth table inputs, using the
+ * C operator precedence the generated code will be compiled with.
+ */
+static unsigned EvalOr(const char **Expr);
+
+static void
+SkipBlanks(const char **Expr)
+{
+    while (' ' == **Expr)
+    {
+        (*Expr)++;
+    }
+}
+
+static unsigned
+EvalUnary(const char **Expr)
+{
+    unsigned Value;
+    char *End;
+
+    SkipBlanks(Expr);
+    switch (**Expr)
+    {
+    case '~':
+        (*Expr)++;
+        return ~EvalUnary(Expr) & 0xff;
+    case '(':
+        (*Expr)++;
+        Value = EvalOr(Expr);
+        SkipBlanks(Expr);
+        if (')' != **Expr)
+        {
+            return ~0u;
+        }
+        (*Expr)++;
+        return Value;
+    case 'D':
+        (*Expr)++;
+        return 0xaa;
+    case 'S':
+        (*Expr)++;
+        return 0xcc;
+    case 'P':
+        (*Expr)++;
+        return 0xf0;
+    default:
+        Value = strtoul(*Expr, &End, 0) & 0xff;
+        *Expr = End;
+        return Value;
+    }
+}
+
+static unsigned
+EvalAnd(const char **Expr)
+{
+    unsigned Value = EvalUnary(Expr);
+
+    for (SkipBlanks(Expr); '&' == **Expr; SkipBlanks(Expr))
+    {
+        (*Expr)++;
+        Value &= EvalUnary(Expr);
+    }
+
+    return Value;
+}
+
+static unsigned
+EvalXor(const char **Expr)
+{
+    unsigned Value = EvalAnd(Expr);
+
+    for (SkipBlanks(Expr); '^' == **Expr; SkipBlanks(Expr))
+    {
+        (*Expr)++;
+        Value ^= EvalAnd(Expr);
+    }
+
+    return Value;
+}
+
+static unsigned
+EvalOr(const char **Expr)
+{
+    unsigned Value = EvalXor(Expr);
+
+    for (SkipBlanks(Expr); '|' == **Expr; SkipBlanks(Expr))
+    {
+        (*Expr)++;
+        Value |= EvalXor(Expr);
+    }
+
+    return Value;
+}
+
+/*
+ * Make sure every specialized routine computes the same thing as the
+ * generic DIB_DoRop path would: the rop code is the truth table of the
+ * operation for D = 0xaa, S = 0xcc and P = 0xf0.
+ */
+static void
+SelfTest(void)
+{
+    unsigned RopCode;
+    PROPINFO RopInfo;
+    const char *Expr;
+    unsigned Value;
+    int Failed = 0;
+
+    for (RopCode = 0; RopCode < 256; RopCode++)
+    {
+        RopInfo = FindRopInfo(RopCode);
+        if (NULL == RopInfo)
+        {
+            continue;
+        }
+
+        Expr = RopInfo->Operation;
+        Value = EvalOr(&Expr);
+        if ('\0' != *Expr || Value != RopCode)
+        {
+            fprintf(stderr, "%s: operation \"%s\" gives 0x%02x, expected 0x%02x\n",
+                    RopInfo->Name, RopInfo->Operation, Value, RopCode);
+            Failed = 1;
+        }
+        if (!RopInfo->UsesDest != !USES_DEST(RopCode) ||
+            !RopInfo->UsesSource != !USES_SOURCE(RopCode) ||
+            !RopInfo->UsesPattern != !USES_PATTERN(RopCode))
+        {
+            fprintf(stderr, "%s: wrong dest/source/pattern usage flags\n",
+                    RopInfo->Name);
+            Failed = 1;
+        }
+    }
+
+    if (Failed)
+    {
+        exit(1);
+    }
+}
+
 static void
 Generate(char *OutputDir, unsigned Bpp)
 {
@@ -1025,6 +1200,8 @@ main(int argc, char *argv[])
     static unsigned DestBpp[] =
     { 8, 16, 32 };
 
+    SelfTest();
+
     if (argc < 2)
         return 0;
 
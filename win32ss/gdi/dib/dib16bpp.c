@@ -370,17 +370,11 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
     for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
     {
-      SourceBits = SourceLine;
-      DestBits = DestLine;
-
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest,
-          *((PDWORD) SourceBits));
-        SourceBits += 4;
-        DestBits += 2;
-      }
+      EXLATEOBJ_vXlateSpan32to16(BltInfo->XlateSourceToDest ?
+                                   (PEXLATEOBJ)BltInfo->XlateSourceToDest : &gexloTrivial,
+                                 (PUSHORT)DestLine,
+                                 (PULONG)SourceLine,
+                                 BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -139,16 +139,11 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
     for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
     {
-      SourceBits = SourceLine;
-      DestBits = DestLine;
-
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = *((PWORD) SourceBits);
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        SourceBits += 2;
-        DestBits += 4;
-      }
+      EXLATEOBJ_vXlateSpan16to32(BltInfo->XlateSourceToDest ?
+                                   (PEXLATEOBJ)BltInfo->XlateSourceToDest : &gexloTrivial,
+                                 (PULONG)DestLine,
+                                 (PUSHORT)SourceLine,
+                                 BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -211,6 +206,20 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         }
       }
     }
+    else if (BltInfo->SourceSurface != BltInfo->DestSurface)
+    {
+      /* Different surfaces can't overlap, translate whole lines */
+      SourceBits = (PBYTE)BltInfo->SourceSurface->pvScan0 + (BltInfo->SourcePoint.y * BltInfo->SourceSurface->lDelta) + 4 * BltInfo->SourcePoint.x;
+      for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
+      {
+        EXLATEOBJ_vXlateSpan32to32((PEXLATEOBJ)BltInfo->XlateSourceToDest,
+                                   (PULONG)DestBits,
+                                   (PULONG)SourceBits,
+                                   BltInfo->DestRect.right - BltInfo->DestRect.left);
+        SourceBits += BltInfo->SourceSurface->lDelta;
+        DestBits += BltInfo->DestSurface->lDelta;
+      }
+    }
     else
     {
       if (BltInfo->DestRect.top < BltInfo->SourcePoint.y)
@@ -383,6 +392,26 @@ DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
     (DestRect->left << 2));
   SrcBpp = BitsPerFormat(Source->iBitmapFormat);
 
+#ifdef _M_IX86
+  /* Unstretched 32bpp sources without color translation take the SSE2 path */
+  if (SrcBpp == 32 &&
+      (ColorTranslation == NULL || (ColorTranslation->flXlate & XO_TRIVIAL)) &&
+      DestRect->right - DestRect->left == SourceRect->right - SourceRect->left &&
+      DestRect->bottom - DestRect->top == SourceRect->bottom - SourceRect->top &&
+      ExIsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+  {
+    DIB_32BPP_AlphaBlendSse2(Dst, Dest->lDelta,
+                             (PBYTE)Source->pvScan0 + SourceRect->top * Source->lDelta +
+                               (SourceRect->left << 2),
+                             Source->lDelta,
+                             DestRect->right - DestRect->left,
+                             DestRect->bottom - DestRect->top,
+                             BlendFunc.SourceConstantAlpha,
+                             (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0);
+    return TRUE;
+  }
+#endif
+
   Rows = 0;
    SrcY = SourceRect->top;
    while (++Rows <= DestRect->bottom - DestRect->top)
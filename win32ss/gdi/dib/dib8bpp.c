@@ -221,16 +221,11 @@ DIB_8BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
       for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
       {
-        SourceBits = SourceLine;
-        DestBits = DestLine;
-
-        for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-        {
-          xColor = *((PDWORD) SourceBits);
-          *DestBits = (BYTE)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-          SourceBits += 4;
-          DestBits += 1;
-        }
+        EXLATEOBJ_vXlateSpan32to8(BltInfo->XlateSourceToDest ?
+                                    (PEXLATEOBJ)BltInfo->XlateSourceToDest : &gexloTrivial,
+                                  DestLine,
+                                  (PULONG)SourceLine,
+                                  BltInfo->DestRect.right - BltInfo->DestRect.left);
 
         SourceLine += BltInfo->SourceSurface->lDelta;
         DestLine += BltInfo->DestSurface->lDelta;
@@ -174,12 +174,50 @@ EXLATEOBJ_iXlateBGRto565(PEXLATEOBJ pxlo, ULONG iColor)
     return iNewColor;
 }
 
+static
+ULONG
+EXLATEOBJ_iGetNearestIndex(PEXLATEOBJ pexlo, ULONG iColor)
+{
+    PXLATE_NEAREST_ENTRY pEntry;
+
+    /* Only red, green and blue take part in the search */
+    iColor &= 0xFFFFFF;
+
+    if (!pexlo->pNearestCache)
+    {
+        /* Don't bother for the few lookups of a brush or a text color */
+        if (++pexlo->cNearestLookups != XLATE_NEAREST_CACHE_THRESHOLD)
+            return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+
+        pexlo->pNearestCache = EngAllocMem(0,
+                                           XLATE_NEAREST_CACHE_SIZE * sizeof(XLATE_NEAREST_ENTRY),
+                                           GDITAG_PXLATE);
+        if (!pexlo->pNearestCache)
+            return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+
+        /* No masked color has the high byte set, so this marks all entries free */
+        RtlFillMemory(pexlo->pNearestCache,
+                      XLATE_NEAREST_CACHE_SIZE * sizeof(XLATE_NEAREST_ENTRY),
+                      0xFF);
+    }
+
+    C_ASSERT(XLATE_NEAREST_CACHE_SIZE == 1 << 10);
+    pEntry = &pexlo->pNearestCache[(iColor * 0x9E3779B1) >> (32 - 10)];
+    if (pEntry->ulColor != iColor)
+    {
+        pEntry->ulColor = iColor;
+        pEntry->iIndex = PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    }
+
+    return pEntry->iIndex;
+}
+
 _Function_class_(FN_XLATE)
 ULONG
 FASTCALL
 EXLATEOBJ_iXlateRGBtoPal(PEXLATEOBJ pexlo, ULONG iColor)
 {
-    return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    return EXLATEOBJ_iGetNearestIndex(pexlo, iColor);
 }
 
 _Function_class_(FN_XLATE)
@@ -252,7 +290,7 @@ EXLATEOBJ_iXlate555toPal(PEXLATEOBJ pexlo, ULONG iColor)
 {
     iColor = EXLATEOBJ_iXlate555toRGB(pexlo, iColor);
 
-    return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    return EXLATEOBJ_iGetNearestIndex(pexlo, iColor);
 }
 
 _Function_class_(FN_XLATE)
@@ -321,7 +359,7 @@ EXLATEOBJ_iXlate565toPal(EXLATEOBJ *pexlo, ULONG iColor)
 {
     iColor = EXLATEOBJ_iXlate565toRGB(pexlo, iColor);
 
-    return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    return EXLATEOBJ_iGetNearestIndex(pexlo, iColor);
 }
 
 _Function_class_(FN_XLATE)
@@ -347,7 +385,7 @@ EXLATEOBJ_iXlateBitfieldsToPal(PEXLATEOBJ pexlo, ULONG iColor)
     iColor = EXLATEOBJ_iXlateShiftAndMask(pexlo, iColor);
 
     /* Return nearest index */
-    return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    return EXLATEOBJ_iGetNearestIndex(pexlo, iColor);
 }
 
 
@@ -380,6 +418,8 @@ EXLATEOBJ_vInitialize(
     pexlo->xlo.iSrcType = (USHORT)ppalSrc->flFlags;
     pexlo->xlo.iDstType = (USHORT)ppalDst->flFlags;
     pexlo->ppalDstDc = &gpalRGB;
+    pexlo->pNearestCache = NULL;
+    pexlo->cNearestLookups = 0;
 
     if (ppalDst == ppalSrc)
     {
@@ -654,8 +694,109 @@ EXLATEOBJ_vCleanup(
         EngFreeMem(pexlo->xlo.pulXlate);
     }
     pexlo->xlo.pulXlate = pexlo->aulXlate;
+
+    if (pexlo->pNearestCache)
+    {
+        EngFreeMem(pexlo->pNearestCache);
+        pexlo->pNearestCache = NULL;
+    }
+}
+
+/*
+ * Span translators for the DIB blit loops. They look at the translation
+ * function once per scanline and run the common conversions inline,
+ * instead of going through XLATEOBJ_iXlate for every pixel.
+ */
+
+#define XLATE_SPAN(pfn, type, pDst, pSrc, cx) \
+    for (i = 0; i < (cx); i++) (pDst)[i] = (type)pfn(pexlo, (pSrc)[i])
+
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan32to32(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PULONG pulDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx)
+{
+    PFN_XLATE pfnXlate = pexlo->pfnXlate;
+    ULONG i;
+
+    if (pfnXlate == EXLATEOBJ_iXlateTrivial)
+        RtlMoveMemory(pulDst, pulSrc, cx * sizeof(ULONG));
+    else if (pfnXlate == EXLATEOBJ_iXlateRGBtoBGR)
+        XLATE_SPAN(EXLATEOBJ_iXlateRGBtoBGR, ULONG, pulDst, pulSrc, cx);
+    else if (pfnXlate == EXLATEOBJ_iXlateShiftAndMask)
+        XLATE_SPAN(EXLATEOBJ_iXlateShiftAndMask, ULONG, pulDst, pulSrc, cx);
+    else
+        XLATE_SPAN(pfnXlate, ULONG, pulDst, pulSrc, cx);
 }
 
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan32to16(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PUSHORT pusDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx)
+{
+    PFN_XLATE pfnXlate = pexlo->pfnXlate;
+    ULONG i;
+
+    if (pfnXlate == EXLATEOBJ_iXlateRGBto565)
+        XLATE_SPAN(EXLATEOBJ_iXlateRGBto565, USHORT, pusDst, pulSrc, cx);
+    else if (pfnXlate == EXLATEOBJ_iXlateBGRto565)
+        XLATE_SPAN(EXLATEOBJ_iXlateBGRto565, USHORT, pusDst, pulSrc, cx);
+    else if (pfnXlate == EXLATEOBJ_iXlateRGBto555)
+        XLATE_SPAN(EXLATEOBJ_iXlateRGBto555, USHORT, pusDst, pulSrc, cx);
+    else if (pfnXlate == EXLATEOBJ_iXlateBGRto555)
+        XLATE_SPAN(EXLATEOBJ_iXlateBGRto555, USHORT, pusDst, pulSrc, cx);
+    else
+        XLATE_SPAN(pfnXlate, USHORT, pusDst, pulSrc, cx);
+}
+
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan32to8(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PBYTE pjDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx)
+{
+    PFN_XLATE pfnXlate = pexlo->pfnXlate;
+    ULONG i;
+
+    if (pfnXlate == EXLATEOBJ_iXlateRGBtoPal)
+        XLATE_SPAN(EXLATEOBJ_iGetNearestIndex, BYTE, pjDst, pulSrc, cx);
+    else
+        XLATE_SPAN(pfnXlate, BYTE, pjDst, pulSrc, cx);
+}
+
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan16to32(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PULONG pulDst,
+    _In_reads_(cx) const USHORT *pusSrc,
+    _In_ ULONG cx)
+{
+    PFN_XLATE pfnXlate = pexlo->pfnXlate;
+    ULONG i;
+
+    if (pfnXlate == EXLATEOBJ_iXlate565toRGB)
+        XLATE_SPAN(EXLATEOBJ_iXlate565toRGB, ULONG, pulDst, pusSrc, cx);
+    else if (pfnXlate == EXLATEOBJ_iXlate565toBGR)
+        XLATE_SPAN(EXLATEOBJ_iXlate565toBGR, ULONG, pulDst, pusSrc, cx);
+    else if (pfnXlate == EXLATEOBJ_iXlate555toRGB)
+        XLATE_SPAN(EXLATEOBJ_iXlate555toRGB, ULONG, pulDst, pusSrc, cx);
+    else if (pfnXlate == EXLATEOBJ_iXlate555toBGR)
+        XLATE_SPAN(EXLATEOBJ_iXlate555toBGR, ULONG, pulDst, pusSrc, cx);
+    else
+        XLATE_SPAN(pfnXlate, ULONG, pulDst, pusSrc, cx);
+}
+
+#undef XLATE_SPAN
+
 /** Public DDI Functions ******************************************************/
 
 #undef XLATEOBJ_iXlate
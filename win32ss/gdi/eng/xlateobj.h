@@ -9,6 +9,16 @@
 
 struct _EXLATEOBJ;
 
+/* Direct-mapped memo of nearest palette index lookups for RGB sources */
+#define XLATE_NEAREST_CACHE_SIZE 1024
+#define XLATE_NEAREST_CACHE_THRESHOLD 16
+
+typedef struct _XLATE_NEAREST_ENTRY
+{
+    ULONG ulColor;
+    ULONG iIndex;
+} XLATE_NEAREST_ENTRY, *PXLATE_NEAREST_ENTRY;
+
 _Function_class_(FN_XLATE)
 typedef
 ULONG
@@ -41,6 +51,9 @@ typedef struct _EXLATEOBJ
             ULONG ulBlueShift;
         };
     };
+
+    PXLATE_NEAREST_ENTRY pNearestCache;
+    ULONG cNearestLookups;
 } EXLATEOBJ, *PEXLATEOBJ;
 
 extern EXLATEOBJ gexloTrivial;
@@ -84,3 +97,35 @@ NTAPI
 EXLATEOBJ_vCleanup(
     _Inout_ PEXLATEOBJ pexlo);
 
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan32to32(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PULONG pulDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx);
+
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan32to16(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PUSHORT pusDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx);
+
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan32to8(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PBYTE pjDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx);
+
+VOID
+FASTCALL
+EXLATEOBJ_vXlateSpan16to32(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PULONG pulDst,
+    _In_reads_(cx) const USHORT *pusSrc,
+    _In_ ULONG cx);
+
@@ -376,6 +376,15 @@ int FASTCALL DocumentEventEx(PVOID,HANDLE,HDC,int,ULONG,PVOID,ULONG,PVOID);
 BOOL FASTCALL EndPagePrinterEx(PVOID,HANDLE);
 BOOL FASTCALL LoadTheSpoolerDrv(VOID);
 
+/*
+ * Only the GDIBATCHCMD commands can be batched, they are shared with win32k
+ * and follow the Windows batch format. BitBlt, Polyline and selecting a
+ * bitmap are not batched on purpose: BitBlt reads a second DC whose surface
+ * the caller may touch directly, Polyline takes an unbounded point array
+ * that does not fit the fixed size entries, and SelectObject must return
+ * the previous bitmap, which only win32k knows. Selecting a pen or a brush
+ * only updates the DC_ATTR and fonts already use GdiBCSelObj.
+ */
 FORCEINLINE
 PVOID
 GdiAllocBatchCommand(
@@ -413,8 +422,16 @@ GdiAllocBatchCommand(
         /* If the batch DC is NULL, we set this one as the new one */
         if (!pTeb->GdiTebBatch.HDC) pTeb->GdiTebBatch.HDC = hdc;
 
-        /* If not, check if the batch DC equal to our DC */
-        else if (pTeb->GdiTebBatch.HDC != hdc) return NULL;
+        /* The batch belongs to another DC: flush it and start a new one
+           for ours, so that runs of calls on a different DC still batch */
+        else if (pTeb->GdiTebBatch.HDC != hdc)
+        {
+            NtGdiFlush();
+            if (!pTeb->GdiTebBatch.HDC) pTeb->GdiTebBatch.HDC = hdc;
+
+            /* Should not happen, but don't mix DCs in a batch */
+            if (pTeb->GdiTebBatch.HDC != hdc) return NULL;
+        }
     }
 
     /* Check if the buffer is full */
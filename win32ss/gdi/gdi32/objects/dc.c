@@ -1097,15 +1097,8 @@ SetROP2(
         return 0;
     }
 
-    if (NtCurrentTeb()->GdiTebBatch.HDC == hdc)
-    {
-        if (pdcattr->ulDirty_ & DC_MODE_DIRTY)
-        {
-            NtGdiFlush();
-            pdcattr->ulDirty_ &= ~DC_MODE_DIRTY;
-        }
-    }
-
+    /* No need to flush the batch: batched PatBlt, PolyPatBlt and text
+       output take their ROP and colors from the command, not from jROP2 */
     rop2Old = pdcattr->jROP2;
     pdcattr->jROP2 = (BYTE)rop2;
 
@@ -1157,15 +1150,7 @@ SetPolyFillMode(
         return 0;
     }
 
-    if (NtCurrentTeb()->GdiTebBatch.HDC == hdc)
-    {
-        if (pdcattr->ulDirty_ & DC_MODE_DIRTY)
-        {
-            NtGdiFlush(); // Sync up pdcattr from Kernel space.
-            pdcattr->ulDirty_ &= ~DC_MODE_DIRTY;
-        }
-    }
-
+    /* None of the batched commands use the fill mode, no need to flush */
     iOldPolyFillMode = pdcattr->lFillMode;
     pdcattr->lFillMode = iPolyFillMode;
 
@@ -25,7 +25,10 @@ typedef struct _FONT_ENTRY_COLL_MEM
 
 typedef struct _FONT_CACHE_ENTRY
 {
-    LIST_ENTRY ListEntry;
+    LIST_ENTRY ListEntry;   /* Entry in the LRU list */
+    LIST_ENTRY HashEntry;   /* Entry in the hash bucket */
+    ULONG Hash;
+    SIZE_T Size;            /* Bytes charged to the cache budget */
     int GlyphIndex;
     FT_Face Face;
     FT_BitmapGlyph BitmapGlyph;
@@ -36,6 +39,15 @@ typedef struct _FONT_CACHE_ENTRY
     MATRIX mxWorldToDevice;
 } FONT_CACHE_ENTRY, *PFONT_CACHE_ENTRY;
 
+typedef struct _FONT_LOOKUP_CACHE_ENTRY
+{
+    LOGFONTW LogFont;       /* Substituted LOGFONT that was looked up */
+    USHORT LangID;          /* The penalties depend on the user language */
+    ULONG Generation;       /* Value of g_FontListGeneration, 0 if unused */
+    FONTOBJ *FontObj;       /* Best match among the global fonts */
+    ULONG MatchPenalty;
+} FONT_LOOKUP_CACHE_ENTRY, *PFONT_LOOKUP_CACHE_ENTRY;
+
 
 /*
  * FONTSUBST_... --- constants for font substitutes
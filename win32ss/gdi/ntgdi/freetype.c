@@ -65,6 +65,7 @@ static PFAST_MUTEX      g_FreeTypeLock;
 
 static LIST_ENTRY       g_FontListHead;
 static PFAST_MUTEX      g_FontListLock;
+static ULONG            g_FontListGeneration = 1;   /* bumped when g_FontListHead changes */
 static BOOL             g_RenderingEnabled = TRUE;
 
 #define IntLockGlobalFonts() \
@@ -88,10 +89,21 @@ static BOOL             g_RenderingEnabled = TRUE;
 #define ASSERT_FREETYPE_LOCK_NOT_HELD() \
     ASSERT(g_FreeTypeLock->Owner != KeGetCurrentThread())
 
-#define MAX_FONT_CACHE 256
+/* Default glyph cache budget in bytes, overridable with
+   GRE_Initialize\GlyphCacheSize in the registry */
+#define MAX_FONT_CACHE_SIZE     (1024 * 1024)
+#define MIN_FONT_CACHE_SIZE     (64 * 1024)
+#define FONT_CACHE_HASH_SIZE    256     /* must be a power of 2 */
 
-static LIST_ENTRY g_FontCacheListHead;
+static LIST_ENTRY g_FontCacheListHead;  /* most recently used first */
+static LIST_ENTRY g_FontCacheHashTable[FONT_CACHE_HASH_SIZE];
 static UINT g_FontCacheNumEntries;
+static SIZE_T g_FontCacheSize;
+static SIZE_T g_FontCacheMaxSize = MAX_FONT_CACHE_SIZE;
+
+/* Memo of the best global font per LOGFONT, see FindBestFontFromGlobalList */
+#define FONT_LOOKUP_CACHE_SIZE  64      /* must be a power of 2 */
+static FONT_LOOKUP_CACHE_ENTRY g_FontLookupCache[FONT_LOOKUP_CACHE_SIZE];
 
 static PWCHAR g_ElfScripts[32] =   /* These are in the order of the fsCsb[0] bits */
 {
@@ -260,9 +272,11 @@ RemoveCachedEntry(PFONT_CACHE_ENTRY Entry)
 
     FT_Done_Glyph((FT_Glyph)Entry->BitmapGlyph);
     RemoveEntryList(&Entry->ListEntry);
-    ExFreePoolWithTag(Entry, TAG_FONT);
+    RemoveEntryList(&Entry->HashEntry);
+    ASSERT(g_FontCacheNumEntries > 0 && g_FontCacheSize >= Entry->Size);
     g_FontCacheNumEntries--;
-    ASSERT(g_FontCacheNumEntries <= MAX_FONT_CACHE);
+    g_FontCacheSize -= Entry->Size;
+    ExFreePoolWithTag(Entry, TAG_FONT);
 }
 
 static void
@@ -660,10 +674,26 @@ BOOL FASTCALL
 InitFontSupport(VOID)
 {
     ULONG ulError;
+    HKEY hKey;
+    DWORD dwValue;
+    UINT i;
 
     InitializeListHead(&g_FontListHead);
     InitializeListHead(&g_FontCacheListHead);
+    for (i = 0; i < FONT_CACHE_HASH_SIZE; ++i)
+    {
+        InitializeListHead(&g_FontCacheHashTable[i]);
+    }
     g_FontCacheNumEntries = 0;
+    g_FontCacheSize = 0;
+
+    /* Read the glyph cache budget */
+    if (NT_SUCCESS(RegOpenKey(L"\\REGISTRY\\MACHINE\\SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\GRE_Initialize", &hKey)))
+    {
+        if (RegReadDWORD(hKey, L"GlyphCacheSize", &dwValue))
+            g_FontCacheMaxSize = max(dwValue, MIN_FONT_CACHE_SIZE);
+        ZwClose(hKey);
+    }
     /* Fast Mutexes must be allocated from non paged pool */
     g_FontListLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
     if (g_FontListLock == NULL)
@@ -1525,6 +1555,7 @@ Finish:
             /* Global font */
             IntLockGlobalFonts();
             AppendTailList(&g_FontListHead, ListToAppend);
+            g_FontListGeneration++;
             IntUnLockGlobalFonts();
         }
 
@@ -3301,6 +3332,22 @@ SameScaleMatrix(
             FLOATOBJ_Equal(&pmx1->efM22, &pmx2->efM22));
 }
 
+static ULONG
+ftGdiGlyphCacheHash(
+    FT_Face Face,
+    INT GlyphIndex,
+    INT Height,
+    FT_Render_Mode RenderMode)
+{
+    ULONG Hash = (ULONG)(ULONG_PTR)Face;
+
+    Hash ^= Hash >> 16;
+    Hash = Hash * 31 + (ULONG)GlyphIndex;
+    Hash = Hash * 31 + (ULONG)Height;
+    Hash = Hash * 31 + (ULONG)RenderMode;
+    return Hash;
+}
+
 FT_BitmapGlyph APIENTRY
 ftGdiGlyphCacheGet(
     FT_Face Face,
@@ -3309,17 +3356,22 @@ ftGdiGlyphCacheGet(
     FT_Render_Mode RenderMode,
     PMATRIX pmx)
 {
-    PLIST_ENTRY CurrentEntry;
+    PLIST_ENTRY CurrentEntry, HashBucket;
     PFONT_CACHE_ENTRY FontEntry;
+    ULONG Hash;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
+    Hash = ftGdiGlyphCacheHash(Face, GlyphIndex, Height, RenderMode);
+    HashBucket = &g_FontCacheHashTable[Hash & (FONT_CACHE_HASH_SIZE - 1)];
+
+    for (CurrentEntry = HashBucket->Flink;
+         CurrentEntry != HashBucket;
          CurrentEntry = CurrentEntry->Flink)
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
-        if ((FontEntry->Face == Face) &&
+        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, HashEntry);
+        if ((FontEntry->Hash == Hash) &&
+            (FontEntry->Face == Face) &&
             (FontEntry->GlyphIndex == GlyphIndex) &&
             (FontEntry->Height == Height) &&
             (FontEntry->RenderMode == RenderMode) &&
@@ -3327,13 +3379,13 @@ ftGdiGlyphCacheGet(
             break;
     }
 
-    if (CurrentEntry == &g_FontCacheListHead)
+    if (CurrentEntry == HashBucket)
     {
         return NULL;
     }
 
-    RemoveEntryList(CurrentEntry);
-    InsertHeadList(&g_FontCacheListHead, CurrentEntry);
+    RemoveEntryList(&FontEntry->ListEntry);
+    InsertHeadList(&g_FontCacheListHead, &FontEntry->ListEntry);
     return FontEntry->BitmapGlyph;
 }
 
@@ -3439,12 +3491,22 @@ ftGdiGlyphCacheSet(
     NewEntry->Height = Height;
     NewEntry->RenderMode = RenderMode;
     NewEntry->mxWorldToDevice = *pmx;
+    NewEntry->Hash = ftGdiGlyphCacheHash(Face, GlyphIndex, Height, RenderMode);
+    NewEntry->Size = sizeof(FONT_CACHE_ENTRY) + sizeof(FT_BitmapGlyphRec) +
+                     (SIZE_T)abs(AlignedBitmap.pitch) * AlignedBitmap.rows;
 
     InsertHeadList(&g_FontCacheListHead, &NewEntry->ListEntry);
-    if (++g_FontCacheNumEntries > MAX_FONT_CACHE)
+    InsertHeadList(&g_FontCacheHashTable[NewEntry->Hash & (FONT_CACHE_HASH_SIZE - 1)],
+                   &NewEntry->HashEntry);
+    g_FontCacheNumEntries++;
+    g_FontCacheSize += NewEntry->Size;
+
+    /* Evict the least recently used glyphs until we fit the budget,
+       but always keep the new one: the caller is about to use it */
+    while (g_FontCacheSize > g_FontCacheMaxSize &&
+           g_FontCacheListHead.Blink != &NewEntry->ListEntry)
     {
-        NewEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
-        RemoveCachedEntry(NewEntry);
+        RemoveCachedEntry(CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry));
     }
 
     return BitmapGlyph;
@@ -5253,6 +5315,71 @@ FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
         ExFreePoolWithTag(Otm, GDITAG_TEXT);
 }
 
+static ULONG
+IntFontLookupHash(const LOGFONTW *LogFont)
+{
+    ULONG Hash = LogFont->lfHeight;
+    UINT i;
+
+    Hash = Hash * 31 + LogFont->lfWidth;
+    Hash = Hash * 31 + LogFont->lfWeight;
+    Hash = Hash * 31 + LogFont->lfCharSet;
+    Hash = Hash * 31 + LogFont->lfItalic;
+    Hash = Hash * 31 + LogFont->lfPitchAndFamily;
+    for (i = 0; i < LF_FACESIZE && LogFont->lfFaceName[i]; ++i)
+    {
+        Hash = Hash * 31 + LogFont->lfFaceName[i];
+    }
+    return Hash;
+}
+
+static BOOL
+IntSameLogFont(const LOGFONTW *LogFont1, const LOGFONTW *LogFont2)
+{
+    return RtlEqualMemory(LogFont1, LogFont2, FIELD_OFFSET(LOGFONTW, lfFaceName)) &&
+           wcsncmp(LogFont1->lfFaceName, LogFont2->lfFaceName, LF_FACESIZE) == 0;
+}
+
+/* Same as FindBestFontFromList on g_FontListHead, but remembers the
+   result. Global fonts are never unloaded, so a remembered FONTOBJ
+   stays valid; adding fonts bumps g_FontListGeneration. */
+static VOID
+FindBestFontFromGlobalList(FONTOBJ **FontObj, ULONG *MatchPenalty,
+                           const LOGFONTW *LogFont)
+{
+    PFONT_LOOKUP_CACHE_ENTRY CacheEntry;
+    FONTOBJ *BestFontObj = NULL;
+    ULONG BestPenalty = 0xFFFFFFFF;
+
+    ASSERT_GLOBALFONTS_LOCK_HELD();
+
+    CacheEntry = &g_FontLookupCache[IntFontLookupHash(LogFont) & (FONT_LOOKUP_CACHE_SIZE - 1)];
+    if (CacheEntry->Generation == g_FontListGeneration &&
+        CacheEntry->LangID == gusLanguageID &&
+        IntSameLogFont(&CacheEntry->LogFont, LogFont))
+    {
+        BestFontObj = CacheEntry->FontObj;
+        BestPenalty = CacheEntry->MatchPenalty;
+    }
+    else
+    {
+        FindBestFontFromList(&BestFontObj, &BestPenalty, LogFont, &g_FontListHead);
+
+        CacheEntry->LogFont = *LogFont;
+        CacheEntry->LangID = gusLanguageID;
+        CacheEntry->Generation = g_FontListGeneration;
+        CacheEntry->FontObj = BestFontObj;
+        CacheEntry->MatchPenalty = BestPenalty;
+    }
+
+    /* the private fonts were searched first and win ties */
+    if (BestFontObj && (*MatchPenalty == 0xFFFFFFFF || BestPenalty < *MatchPenalty))
+    {
+        *FontObj = BestFontObj;
+        *MatchPenalty = BestPenalty;
+    }
+}
+
 static
 VOID
 FASTCALL
@@ -5389,8 +5516,7 @@ TextIntRealizeFont(HFONT FontHandle, PTEXTOBJ pTextObj)
 
     /* Search system fonts */
     IntLockGlobalFonts();
-    FindBestFontFromList(&TextObj->Font, &MatchPenalty, &SubstitutedLogFont,
-                         &g_FontListHead);
+    FindBestFontFromGlobalList(&TextObj->Font, &MatchPenalty, &SubstitutedLogFont);
     IntUnLockGlobalFonts();
 
     if (NULL == TextObj->Font)
@@ -15,6 +15,7 @@
 extern PENTRY gpentHmgr;
 extern PULONG gpaulRefCount;
 extern ULONG gulFirstUnused;
+extern ULONG gaulLockWaits[GDIObjTypeTotal + 1];
 
 
 static const char * gpszObjectTypes[] =
@@ -69,6 +70,7 @@ KdbCommand_Gdi_help(VOID)
              "- handle <handle> - Displays information about a handle\n"
              "- entry <entry> - Displays an ENTRY, <entry> can be a pointer or index\n"
              "- baseobject <object> - Displays a BASEOBJECT\n"
+             "- lockwaits - Displays how often object locks were contended\n"
 #if DBG_ENABLE_EVENT_LOGGING
              "- eventlist <object> - Displays the eventlist for an object\n"
 #endif
@@ -176,6 +178,25 @@ leave:
     KeUnstackDetachProcess(&ApcState);
 }
 
+static
+VOID
+KdbCommand_Gdi_lockwaits(VOID)
+{
+    ULONG i;
+
+    DbgPrint("Type         Waits\n");
+    DbgPrint("-------------------\n");
+    for (i = 0; i <= GDIObjType_MAX_TYPE; i++)
+    {
+        /* Only show the types that were contended */
+        if (gaulLockWaits[i] == 0) continue;
+
+        DbgPrint("%02x %-9s %lu\n",
+                 i, gpszObjectTypes[i], gaulLockWaits[i]);
+    }
+    DbgPrint("\n");
+}
+
 static
 VOID
 KdbCommand_Gdi_handle(char *argv)
@@ -347,6 +368,10 @@ DbgGdiKdbgCliCallback(
     {
         KdbCommand_Gdi_baseobject(argv[1]);
     }
+    else if (stricmp(argv[0], "!gdi.lockwaits") == 0)
+    {
+        KdbCommand_Gdi_lockwaits();
+    }
 #if DBG_ENABLE_EVENT_LOGGING
     else if (stricmp(argv[0], "!gdi.eventlist") == 0)
     {
@@ -152,6 +152,9 @@ volatile ULONG gulFirstFree;
 volatile ULONG gulFirstUnused;
 static PPAGED_LOOKASIDE_LIST gpaLookasideList;
 
+/* Number of times a lock could not be acquired right away, per object type */
+ULONG gaulLockWaits[GDIObjTypeTotal + 1];
+
 static VOID NTAPI GDIOBJ_vCleanup(PVOID ObjectBody);
 
 static const
@@ -477,9 +480,12 @@ static
 PENTRY
 ENTRY_ReferenceEntryByHandle(HGDIOBJ hobj, FLONG fl)
 {
-    ULONG ulIndex, cNewRefs, cOldRefs;
+    ULONG ulIndex, cNewRefs, cOldRefs, ulProcessId;
     PENTRY pentry;
 
+    /* Get the process id once, the loop below may be retried */
+    ulProcessId = PtrToUlong(PsGetCurrentProcessId());
+
     /* Get the handle index and check if its too big */
     ulIndex = GDI_HANDLE_GET_INDEX(hobj);
 
@@ -509,7 +515,7 @@ ENTRY_ReferenceEntryByHandle(HGDIOBJ hobj, FLONG fl)
         /* Check if the object owner is this process or public */
         if (!(fl & GDIOBJFLAG_IGNOREPID) &&
             pentry->ObjectOwner.ulObj != GDI_OBJ_HMGR_PUBLIC &&
-            pentry->ObjectOwner.ulObj != PtrToUlong(PsGetCurrentProcessId()))
+            pentry->ObjectOwner.ulObj != ulProcessId)
         {
             DPRINT("GDIOBJ: Cannot reference foreign handle %p, pentry=%p:%lx.\n",
                     hobj, pentry, pentry->ObjectOwner.ulObj);
@@ -792,6 +798,7 @@ GDIOBJ_TryLockObject(
             ULONG cRefs, ulIndex;
             /* Already owned. Clean up and leave. */
             KeLeaveCriticalRegion();
+            InterlockedIncrement((LONG*)&gaulLockWaits[objt]);
 
             /* Calculate the index */
             ulIndex = GDI_HANDLE_GET_INDEX(pobj->hHmgr);
@@ -856,7 +863,12 @@ GDIOBJ_LockObject(
     {
         /* Disable APCs and acquire the push lock */
         KeEnterCriticalRegion();
-        ExAcquirePushLockExclusive(&pobj->pushlock);
+        if (!ExTryAcquirePushLockExclusive(&pobj->pushlock))
+        {
+            /* Someone else holds it, account for the wait and block */
+            InterlockedIncrement((LONG*)&gaulLockWaits[objt]);
+            ExAcquirePushLockExclusive(&pobj->pushlock);
+        }
 
         /* Set us as lock owner */
         ASSERT(pobj->dwThreadId == 0);
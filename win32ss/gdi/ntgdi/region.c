@@ -155,6 +155,13 @@ HRGN    hrgnDefault = NULL;
 
 #define REGION_NOT_EMPTY(pReg) pReg->rdh.nCount
 
+/* Check if rect r1 contains rect r2 */
+#define RECTCONTAINS(r1, r2) \
+    ((r1)->left <= (r2)->left && \
+     (r1)->top <= (r2)->top && \
+     (r1)->right >= (r2)->right && \
+     (r1)->bottom >= (r2)->bottom)
+
 #define INRECT(r, x, y) \
       ( ( ((r).right >  x)) && \
         ( ((r).left <= x)) && \
@@ -1315,6 +1322,27 @@ REGION_IntersectRegion(
     {
         newReg->rdh.nCount = 0;
     }
+    /* A single rectangle that covers the other region leaves it unchanged */
+    else if ((reg2->rdh.nCount == 1) &&
+             RECTCONTAINS(&reg2->rdh.rcBound, &reg1->rdh.rcBound))
+    {
+        return REGION_CopyRegion(newReg, reg1);
+    }
+    else if ((reg1->rdh.nCount == 1) &&
+             RECTCONTAINS(&reg1->rdh.rcBound, &reg2->rdh.rcBound))
+    {
+        return REGION_CopyRegion(newReg, reg2);
+    }
+    /* Two overlapping rectangles intersect to a rectangle */
+    else if ((reg1->rdh.nCount == 1) && (reg2->rdh.nCount == 1))
+    {
+        REGION_SetRectRgn(newReg,
+                          max(reg1->rdh.rcBound.left, reg2->rdh.rcBound.left),
+                          max(reg1->rdh.rcBound.top, reg2->rdh.rcBound.top),
+                          min(reg1->rdh.rcBound.right, reg2->rdh.rcBound.right),
+                          min(reg1->rdh.rcBound.bottom, reg2->rdh.rcBound.bottom));
+        return TRUE;
+    }
     else
     {
         if (!REGION_RegionOp(newReg,
@@ -1742,6 +1770,14 @@ REGION_SubtractRegion(
         return REGION_CopyRegion(regD, regM);
     }
 
+    /* Subtracting a rectangle that covers the whole region leaves nothing */
+    if ((regS->rdh.nCount == 1) &&
+        RECTCONTAINS(&regS->rdh.rcBound, &regM->rdh.rcBound))
+    {
+        EMPTY_REGION(regD);
+        return TRUE;
+    }
+
     if (!REGION_RegionOp(regD,
                     regM,
                     regS,
@@ -1839,6 +1875,25 @@ REGION_SubtractRectFromRgn(
     return REGION_Complexity(prgnDest);
 }
 
+INT
+FASTCALL
+REGION_IntersectRectWithRgn(
+    PREGION prgnDest,
+    PREGION prgnSrc,
+    const RECTL *prcl)
+{
+    REGION rgnLocal;
+
+    rgnLocal.Buffer = &rgnLocal.rdh.rcBound;
+    rgnLocal.rdh.nCount = 1;
+    rgnLocal.rdh.nRgnSize = sizeof(RECT);
+    rgnLocal.rdh.rcBound = *prcl;
+    if (!REGION_IntersectRegion(prgnDest, prgnSrc, &rgnLocal))
+        return ERROR;
+
+    return REGION_Complexity(prgnDest);
+}
+
 BOOL
 FASTCALL
 REGION_bCopy(
@@ -27,6 +27,7 @@ PREGION FASTCALL REGION_AllocRgnWithHandle(INT n);
 PREGION FASTCALL REGION_AllocUserRgnWithHandle(INT n);
 BOOL FASTCALL REGION_UnionRectWithRgn(PREGION rgn, const RECTL *rect);
 INT FASTCALL REGION_SubtractRectFromRgn(PREGION prgnDest, PREGION prgnSrc, const RECTL *prcl);
+INT FASTCALL REGION_IntersectRectWithRgn(PREGION prgnDest, PREGION prgnSrc, const RECTL *prcl);
 INT FASTCALL REGION_GetRgnBox(PREGION Rgn, RECTL *pRect);
 BOOL FASTCALL REGION_RectInRegion(PREGION Rgn, const RECTL *rc);
 BOOL FASTCALL REGION_PtInRegion(PREGION, INT, INT);
@@ -474,6 +474,8 @@ InitThreadCallback(PETHREAD Thread)
     InitializeListHead(&ptiCurrent->WindowListHead);
     InitializeListHead(&ptiCurrent->W32CallbackListHead);
     InitializeListHead(&ptiCurrent->PostedMessagesListHead);
+    ptiCurrent->uPostedMsgMin = ~0U;
+    ptiCurrent->uPostedMsgMax = 0;
     InitializeListHead(&ptiCurrent->SentMessagesListHead);
     InitializeListHead(&ptiCurrent->PtiLink);
     for (i = 0; i < NB_HOOKS; i++)
@@ -524,7 +524,7 @@ MsqPostMouseMove(PTHREADINFO pti, MSG* Msg, LONG_PTR ExtraInfo)
     ListHead = &MessageQueue->HardwareMessagesListHead;
 
     // Do nothing if empty.
-    if (!IsListEmpty(ListHead->Flink))
+    if (!IsListEmpty(ListHead))
     {
        // Look at the end of the list,
        Message = CONTAINING_RECORD(ListHead->Blink, USER_MESSAGE, ListEntry);
@@ -534,6 +534,7 @@ MsqPostMouseMove(PTHREADINFO pti, MSG* Msg, LONG_PTR ExtraInfo)
        {
           // Overwrite the message with updated data!
           Message->Msg = *Msg;
+          Message->ExtraInfo = ExtraInfo;
 
           MsqWakeQueue(pti, QS_MOUSEMOVE, TRUE);
           return;
@@ -1361,6 +1362,10 @@ MsqPostMessage(PTHREADINFO pti,
    if (!HardwareMessage)
    {
        InsertTailList(&pti->PostedMessagesListHead, &Message->ListEntry);
+
+       // Widen the id bounds used to reject filtered peeks.
+       if (Msg->message < pti->uPostedMsgMin) pti->uPostedMsgMin = Msg->message;
+       if (Msg->message > pti->uPostedMsgMax) pti->uPostedMsgMax = Msg->message;
    }
    else
    {
@@ -2119,9 +2124,22 @@ MsqPeekMessage(IN PTHREADINFO pti,
    DWORD QS_Flags;
    BOOL Ret = FALSE;
 
-   ListHead = pti->PostedMessagesListHead.Flink;
+   if (IsListEmpty(&pti->PostedMessagesListHead))
+   {
+      // Start over with empty bounds.
+      pti->uPostedMsgMin = ~0U;
+      pti->uPostedMsgMax = 0;
+      return FALSE;
+   }
 
-   if (IsListEmpty(ListHead)) return FALSE;
+   // Nothing ever posted falls in the requested range, skip the scan.
+   if ( ( MsgFilterLow != 0 || MsgFilterHigh != 0 ) &&
+        ( MsgFilterHigh < pti->uPostedMsgMin || MsgFilterLow > pti->uPostedMsgMax ) )
+   {
+      return FALSE;
+   }
+
+   ListHead = pti->PostedMessagesListHead.Flink;
 
    while(ListHead != &pti->PostedMessagesListHead)
    {
@@ -468,6 +468,7 @@ co_IntPaintWindows(PWND Wnd, ULONG Flags, BOOL Recurse)
 
    if (!(Flags & RDW_NOCHILDREN) &&
        !(Wnd->style & WS_MINIMIZE) &&
+       Wnd->spwndChild != NULL &&
         ( Flags & RDW_ALLCHILDREN ||
          (Flags & RDW_CLIPCHILDREN && Wnd->style & WS_CLIPCHILDREN) ) )
    {
@@ -642,14 +643,7 @@ IntInvalidateWindows(PWND Wnd, PREGION Rgn, ULONG Flags)
        */
       if ((Flags & RDW_INVALIDATE) != 0 && (Flags & RDW_FRAME) == 0)
       {
-         PREGION RgnClient;
-
-         RgnClient = IntSysCreateRectpRgnIndirect(&Wnd->rcClient);
-         if (RgnClient)
-         {
-             RgnType = IntGdiCombineRgn(Rgn, Rgn, RgnClient, RGN_AND);
-             REGION_Delete(RgnClient);
-         }
+         RgnType = REGION_IntersectRectWithRgn(Rgn, Rgn, &Wnd->rcClient);
       }
 
       /*
@@ -658,12 +652,7 @@ IntInvalidateWindows(PWND Wnd, PREGION Rgn, ULONG Flags)
 
       if (!Wnd->hrgnClip || (Wnd->style & WS_MINIMIZE))
       {
-         PREGION RgnWindow = IntSysCreateRectpRgnIndirect(&Wnd->rcWindow);
-         if (RgnWindow)
-         {
-             RgnType = IntGdiCombineRgn(Rgn, Rgn, RgnWindow, RGN_AND);
-             REGION_Delete(RgnWindow);
-         }
+         RgnType = REGION_IntersectRectWithRgn(Rgn, Rgn, &Wnd->rcWindow);
       }
       else
       {
@@ -816,15 +805,42 @@ IntInvalidateWindows(PWND Wnd, PREGION Rgn, ULONG Flags)
          ((Flags & RDW_ALLCHILDREN) || !(Wnd->style & WS_CLIPCHILDREN)))
    { 
       PWND Child;
+      PREGION RgnTemp, RgnEmpty = NULL;
+      RECTL rcChild;
 
       for (Child = Wnd->spwndChild; Child; Child = Child->spwndNext)
       {
          if (Child->style & WS_VISIBLE)
          {
+            /*
+             * A child clipped by its window rectangle that lies outside of
+             * the region ends up with an empty region, and so do all of its
+             * own children. It still needs its flags updated, but it can
+             * share one empty region instead of getting a copy of ours.
+             */
+            if (Rgn > PRGN_WINDOW && REGION_Complexity(Rgn) == NULLREGION)
+            {
+               /* Ours is empty already and stays that way */
+               IntInvalidateWindows(Child, Rgn, Flags);
+               continue;
+            }
+
+            if (Rgn > PRGN_WINDOW &&
+                (!Child->hrgnClip || (Child->style & WS_MINIMIZE)) &&
+                !RECTL_bIntersectRect(&rcChild, &Rgn->rdh.rcBound, &Child->rcWindow))
+            {
+               if (!RgnEmpty) RgnEmpty = IntSysCreateRectpRgn(0, 0, 0, 0);
+               if (RgnEmpty)
+               {
+                  IntInvalidateWindows(Child, RgnEmpty, Flags);
+                  continue;
+               }
+            }
+
             /*
              * Recursive call to update children hrgnUpdate
              */
-            PREGION RgnTemp = IntSysCreateRectpRgn(0, 0, 0, 0);
+            RgnTemp = IntSysCreateRectpRgn(0, 0, 0, 0);
             if (RgnTemp)
             {
                 if (Rgn > PRGN_WINDOW) IntGdiCombineRgn(RgnTemp, Rgn, 0, RGN_COPY);
@@ -833,6 +849,8 @@ IntInvalidateWindows(PWND Wnd, PREGION Rgn, ULONG Flags)
             }
          }
       }
+
+      if (RgnEmpty) REGION_Delete(RgnEmpty);
    }
    TRACE("IntInvalidateWindows exit\n");
 }
@@ -9,6 +9,19 @@
 #include <win32k.h>
 DBG_DEFAULT_CHANNEL(UserWinpos);
 
+/* Check if a window rectangle can clip anything from the region */
+static __inline BOOLEAN
+VIS_bRectOverlapsRgn(
+   const RECTL *prcl,
+   PREGION Rgn)
+{
+   return Rgn->rdh.nCount != 0 &&
+          prcl->left < Rgn->rdh.rcBound.right &&
+          prcl->right > Rgn->rdh.rcBound.left &&
+          prcl->top < Rgn->rdh.rcBound.bottom &&
+          prcl->bottom > Rgn->rdh.rcBound.top;
+}
+
 PREGION FASTCALL
 VIS_ComputeVisibleRegion(
    PWND Wnd,
@@ -16,7 +29,7 @@ VIS_ComputeVisibleRegion(
    BOOLEAN ClipChildren,
    BOOLEAN ClipSiblings)
 {
-   PREGION VisRgn, ClipRgn;
+   PREGION VisRgn, ClipRgn, SiblingClipRgn;
    PWND PreviousWindow, CurrentWindow, CurrentSibling;
 
    if (!Wnd || !(Wnd->style & WS_VISIBLE))
@@ -35,6 +48,11 @@ VIS_ComputeVisibleRegion(
       VisRgn = IntSysCreateRectpRgnIndirect(&Wnd->rcWindow);
    }
 
+   if (!VisRgn)
+   {
+      return NULL;
+   }
+
    /*
     * Walk through all parent windows and for each clip the visble region
     * to the parent's client area and exclude all siblings that are over
@@ -60,9 +78,15 @@ VIS_ComputeVisibleRegion(
          return NULL;
       }
 
-      ClipRgn = IntSysCreateRectpRgnIndirect(&CurrentWindow->rcClient);
-      IntGdiCombineRgn(VisRgn, VisRgn, ClipRgn, RGN_AND);
-      REGION_Delete(ClipRgn);
+      REGION_IntersectRectWithRgn(VisRgn, VisRgn, &CurrentWindow->rcClient);
+
+      /* Once nothing is left, only the visibility of the parents matters */
+      if (VisRgn->rdh.nCount == 0)
+      {
+         PreviousWindow = CurrentWindow;
+         CurrentWindow = CurrentWindow->spwndParent;
+         continue;
+      }
 
       if ((PreviousWindow->style & WS_CLIPSIBLINGS) ||
           (PreviousWindow == Wnd && ClipSiblings))
@@ -72,20 +96,26 @@ VIS_ComputeVisibleRegion(
                  CurrentSibling != PreviousWindow )
          {
             if ((CurrentSibling->style & WS_VISIBLE) &&
-                !(CurrentSibling->ExStyle & WS_EX_TRANSPARENT))
+                !(CurrentSibling->ExStyle & WS_EX_TRANSPARENT) &&
+                VIS_bRectOverlapsRgn(&CurrentSibling->rcWindow, VisRgn))
             {
+               /* Plain rectangular siblings don't need a temporary region */
+               if (!CurrentSibling->hrgnClip || (CurrentSibling->style & WS_MINIMIZE))
+               {
+                  REGION_SubtractRectFromRgn(VisRgn, VisRgn, &CurrentSibling->rcWindow);
+                  CurrentSibling = CurrentSibling->spwndNext;
+                  continue;
+               }
+
                ClipRgn = IntSysCreateRectpRgnIndirect(&CurrentSibling->rcWindow);
-               /* Combine it with the window region if available */
-               if (CurrentSibling->hrgnClip && !(CurrentSibling->style & WS_MINIMIZE))
+               /* Combine it with the window region */
+               SiblingClipRgn = REGION_LockRgn(CurrentSibling->hrgnClip);
+               if (SiblingClipRgn)
                {
-                  PREGION SiblingClipRgn = REGION_LockRgn(CurrentSibling->hrgnClip);
-                  if (SiblingClipRgn)
-                  {
-                      REGION_bOffsetRgn(ClipRgn, -CurrentSibling->rcWindow.left, -CurrentSibling->rcWindow.top);
-                      IntGdiCombineRgn(ClipRgn, ClipRgn, SiblingClipRgn, RGN_AND);
-                      REGION_bOffsetRgn(ClipRgn, CurrentSibling->rcWindow.left, CurrentSibling->rcWindow.top);
-                      REGION_UnlockRgn(SiblingClipRgn);
-                  }
+                   REGION_bOffsetRgn(ClipRgn, -CurrentSibling->rcWindow.left, -CurrentSibling->rcWindow.top);
+                   IntGdiCombineRgn(ClipRgn, ClipRgn, SiblingClipRgn, RGN_AND);
+                   REGION_bOffsetRgn(ClipRgn, CurrentSibling->rcWindow.left, CurrentSibling->rcWindow.top);
+                   REGION_UnlockRgn(SiblingClipRgn);
                }
                IntGdiCombineRgn(VisRgn, VisRgn, ClipRgn, RGN_DIFF);
                REGION_Delete(ClipRgn);
@@ -104,20 +134,25 @@ VIS_ComputeVisibleRegion(
       while (CurrentWindow)
       {
          if ((CurrentWindow->style & WS_VISIBLE) &&
-             !(CurrentWindow->ExStyle & WS_EX_TRANSPARENT))
+             !(CurrentWindow->ExStyle & WS_EX_TRANSPARENT) &&
+             VIS_bRectOverlapsRgn(&CurrentWindow->rcWindow, VisRgn))
          {
+            if (!CurrentWindow->hrgnClip || (CurrentWindow->style & WS_MINIMIZE))
+            {
+               REGION_SubtractRectFromRgn(VisRgn, VisRgn, &CurrentWindow->rcWindow);
+               CurrentWindow = CurrentWindow->spwndNext;
+               continue;
+            }
+
             ClipRgn = IntSysCreateRectpRgnIndirect(&CurrentWindow->rcWindow);
-            /* Combine it with the window region if available */
-            if (CurrentWindow->hrgnClip && !(CurrentWindow->style & WS_MINIMIZE))
+            /* Combine it with the window region */
+            SiblingClipRgn = REGION_LockRgn(CurrentWindow->hrgnClip);
+            if (SiblingClipRgn)
             {
-               PREGION CurrentRgnClip = REGION_LockRgn(CurrentWindow->hrgnClip);
-               if (CurrentRgnClip)
-               {
-                   REGION_bOffsetRgn(ClipRgn, -CurrentWindow->rcWindow.left, -CurrentWindow->rcWindow.top);
-                   IntGdiCombineRgn(ClipRgn, ClipRgn, CurrentRgnClip, RGN_AND);
-                   REGION_bOffsetRgn(ClipRgn, CurrentWindow->rcWindow.left, CurrentWindow->rcWindow.top);
-                   REGION_UnlockRgn(CurrentRgnClip);
-               }
+                REGION_bOffsetRgn(ClipRgn, -CurrentWindow->rcWindow.left, -CurrentWindow->rcWindow.top);
+                IntGdiCombineRgn(ClipRgn, ClipRgn, SiblingClipRgn, RGN_AND);
+                REGION_bOffsetRgn(ClipRgn, CurrentWindow->rcWindow.left, CurrentWindow->rcWindow.top);
+                REGION_UnlockRgn(SiblingClipRgn);
             }
             IntGdiCombineRgn(VisRgn, VisRgn, ClipRgn, RGN_DIFF);
             REGION_Delete(ClipRgn);
@@ -145,6 +145,9 @@ typedef struct _THREADINFO
     // Hard list QS_MOUSE|QS_KEY only
     // Accounting of queue bit sets, the rest are flags. QS_TIMER QS_PAINT counts are handled in thread information.
     DWORD nCntsQBits[QSIDCOUNTS]; // QS_KEY QS_MOUSEMOVE QS_MOUSEBUTTON QS_POSTMESSAGE QS_SENDMESSAGE QS_HOTKEY
+    // Lowest and highest message id put on the post list since it was last found empty.
+    UINT uPostedMsgMin;
+    UINT uPostedMsgMax;
 
     LIST_ENTRY WindowListHead;
     LIST_ENTRY W32CallbackListHead;